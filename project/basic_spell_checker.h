@@ -0,0 +1,153 @@
+#pragma once
+
+#include "spell_checker_engines.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <type_traits>
+#include <cctype>
+
+// is string recognized as word to check for spelling or should be skipped
+inline bool is_valid_word(const std::string &word)
+{
+    if (!((isalpha(word.back()) || word.back() == '\'') && (isalpha(word[0]))) || word.size() > 45)
+        return false;
+    for (int i = 1; i < (int)word.size() - 1; ++i)
+        if (!(isalpha(word[i]) || word[i] == '\''))
+            return false;
+
+    return true;
+}
+
+namespace spell_checker_detail
+{
+// true for a single argument of type T, so that forwarding constructors
+// do not take over copy and move
+template <class T, class... Args>
+struct is_self : std::false_type
+{
+};
+template <class T, class Arg>
+struct is_self<T, Arg> : std::is_same<typename std::decay<Arg>::type, T>
+{
+};
+} // namespace spell_checker_detail
+
+// Spell checker bound to a concrete engine at compile time. Nothing is
+// dispatched virtually, so per-word loops inline the engine lookup.
+template <class Engine>
+class BasicSpellChecker
+{
+  public:
+    template <class... Args,
+              class = typename std::enable_if<!spell_checker_detail::is_self<BasicSpellChecker, Args...>::value>::type>
+    explicit BasicSpellChecker(Args &&... args) : engine_(std::forward<Args>(args)...) {}
+
+    // Loads dictionary into memory. Throws exception if any issues
+    void load(const std::string &dictionary) { engine_.load(dictionary); }
+
+    // Loads dictionary using given number of threads (0 - hardware concurrency)
+    void load_parallel(const std::string &dictionary, unsigned threads = 0)
+    {
+        engine_.load_parallel(dictionary, threads);
+    }
+
+    // returns true if word is in dictionary else false
+    bool check(const std::string &word) const { return engine_.check(word); }
+
+    // checks every token of document; with dedup each distinct token
+    // is validated and looked up once and results are expanded back. Dedup
+    // costs a hash probe per token, so it only pays off for engines with
+    // slower lookup (Vector, Set)
+    SpellChecker_Report check_document(const std::vector<std::string> &tokens, bool dedup = false) const;
+
+    // adds word to dictionary in-memory
+    void add(const std::string &word) { engine_.add(word); }
+
+    // sets frequency weight of dictionary word used by CompletionOrder::Weight,
+    // returns false if word is not in dictionary or engine keeps no weights
+    bool set_weight(const std::string &word, unsigned weight) { return engine_.set_weight(word, weight); }
+
+    // fills out[0..n) with up to k dictionary words starting with prefix and
+    // returns n; out is never shrunk so a reused vector does not reallocate
+    size_t complete(const std::string &prefix, size_t k, std::vector<SpellChecker_Completion> &out,
+                    CompletionOrder order = CompletionOrder::Lexicographic) const
+    {
+        if (!k)
+            return 0;
+        if (out.size() < k)
+            out.resize(k);
+        CompletionSink sink(out.data(), k, order);
+        engine_.complete(prefix, sink);
+        return sink.finish();
+    }
+
+    // Returns number of words in dictionary if loaded else 0 if not yet loaded
+    size_t size(void) const { return engine_.size(); }
+
+    // Returns nodes and bytes used by engine (zeros if engine does not track them)
+    SpellChecker_Stats stats(void) const { return engine_.stats(); }
+
+    static bool is_valid(const std::string &word) { return is_valid_word(word); }
+
+  private:
+    // distinct tokens are interned by pointer into the caller's vector
+    struct TokenHash
+    {
+        size_t operator()(const std::string *token) const { return std::hash<std::string>()(*token); }
+    };
+    struct TokenEqual
+    {
+        bool operator()(const std::string *a, const std::string *b) const { return *a == *b; }
+    };
+
+    Engine engine_;
+};
+
+template <class Engine>
+SpellChecker_Report BasicSpellChecker<Engine>::check_document(const std::vector<std::string> &tokens, bool dedup) const
+{
+    SpellChecker_Report report;
+    report.total = tokens.size();
+    if (!dedup)
+    {
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            if (!is_valid_word(tokens[i]))
+                continue;
+            ++report.valid;
+            if (!engine_.check(tokens[i]))
+                report.offsets.push_back(i);
+        }
+        report.misspelled = report.offsets.size();
+        return report;
+    }
+
+    enum : char { Invalid, Correct, Misspelled };
+    std::unordered_map<const std::string *, unsigned, TokenHash, TokenEqual> ids;
+    ids.reserve(tokens.size() / 8);
+    std::vector<char> verdict;
+    std::vector<unsigned> token_ids(tokens.size());
+    for (size_t i = 0; i < tokens.size(); ++i)
+    {
+        auto res = ids.emplace(&tokens[i], (unsigned)verdict.size());
+        if (res.second)
+        {
+            const std::string &word = tokens[i];
+            verdict.push_back(!is_valid_word(word) ? Invalid : engine_.check(word) ? Correct : Misspelled);
+        }
+        token_ids[i] = res.first->second;
+    }
+    for (size_t i = 0; i < tokens.size(); ++i)
+    {
+        char v = verdict[token_ids[i]];
+        if (v == Invalid)
+            continue;
+        ++report.valid;
+        if (v == Misspelled)
+            report.offsets.push_back(i);
+    }
+    report.misspelled = report.offsets.size();
+    return report;
+}
@@ -1,317 +1,128 @@
-#include "spell_checker.h"
-#include <vector>
-#include <set>
-#include <memory>
-#include <unordered_set>
-#include <fstream>
-#include <algorithm>
-#include <functional>
+#include "basic_spell_checker.h"
+#include "spell_checker_journal.h"
 
-const unsigned int MAX_HASH = 501037;
-
-std::string::const_iterator it;
-
-unsigned int string_hash(const std::string &word, unsigned int max) {
-	std::hash<std::string> hash_str;
-	return hash_str(word) % MAX_HASH;
-}
-
-inline int getIndex(char c) {
-	return (c != '\'' ? c & ~0x60 : 0);
-}
-class SpellChecker_Vector : public SpellChecker_Impl
-{
-public:
-	SpellChecker_Vector() : dict(27) {}
-	void load(const std::string &dictionary) {
-		std::ifstream file(dictionary);
-		if (file.fail())
-			throw SpellChecker_InvalidDictFile();
-		std::string tmp;
-		while (file >> tmp)
-			dict[getIndex(tmp[0])].push_back(tmp);
-	}
-	bool check(const std::string &word) const {
-		std::string wordLower(word);
-		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
-		const std::vector<std::string> &v = dict[getIndex(wordLower[0])];
-		for (int i = 0; i < v.size(); ++i)
-			if (v[i] == wordLower)
-				return true;
-		return false;
-	}
-	void add(const std::string &word) {
-		std::string wordLower(word);
-		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
-		if (!check(wordLower))
-			dict[getIndex(wordLower[0])].push_back(wordLower);
-	}
-	size_t size(void) const { 
-		size_t res = 0;
-		for (int i = 0; i < dict.size(); ++i)
-			res += dict[i].size();
-		return res; }
-private:
-	std::vector<std::vector<std::string>> dict;
-};
-
-class SpellChecker_Set : public SpellChecker_Impl
-{
-public:
-	void load(const std::string &dictionary) {
-		std::ifstream file(dictionary);
-		if (file.fail())
-			throw SpellChecker_InvalidDictFile();
-		std::string tmp;
-		while (file >> tmp)
-			dict.insert(tmp);
-	}
-	bool check(const std::string &word) const {
-		std::string wordLower(word);
-		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
-		return dict.find(wordLower) != dict.end();
-	}
-	void add(const std::string &word) {
-		std::string wordLower(word);
-		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
-		dict.insert(wordLower);
-	}
-	size_t size(void) const { return dict.size(); }
-private:
-	std::set<std::string> dict;
-};
-
-class SpellChecker_UnorderedSet : public SpellChecker_Impl
-{
-public:
-	void load(const std::string &dictionary) {
-		std::ifstream file(dictionary);
-		if (file.fail())
-			throw SpellChecker_InvalidDictFile();
-		std::string tmp;
-		while (file >> tmp)
-			dict.insert(tmp);
-	}
-	bool check(const std::string &word) const {
-		std::string wordLower(word);
-		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
-		return dict.find(wordLower) != dict.end();
-	}
-	void add(const std::string &word) {
-		std::string wordLower(word);
-		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
-		dict.insert(wordLower);
-	}
-	size_t size(void) const { return dict.size(); }
-private:
-	std::unordered_set<std::string> dict;
-};
-
-class HashNode {
-public:
-	HashNode() = default;
-	HashNode(const std::string &str) : _str(str) {}
-	std::shared_ptr<HashNode> next() {
-		return _next;
-	}
-	void setNext(const std::string &str) {
-		_next = std::shared_ptr<HashNode>(new HashNode(str));
-	}
-	void setString(const std::string &str) {
-		_str = str;
-	}
-	bool isEmpty() {
-		return _str != "";
-	}
-	std::string str() {
-		return _str;
-	}
-	bool compare(const std::string &str) {
-		return _str == str;
-	}
-private:
-	std::string _str;
-	std::shared_ptr<HashNode> _next;
-};
-
-class SpellChecker_CustomHashTable : public SpellChecker_Impl
+// runtime selected engine behind the virtual interface; every call lands
+// in BasicSpellChecker<Engine>, whose loops are compiled per engine
+template <class Engine>
+class SpellChecker_Model final : public SpellChecker_Impl
 {
-private:
-	std::vector<std::shared_ptr<HashNode>> dict;
-	size_t _size = 0;
 public:
-	SpellChecker_CustomHashTable() : dict(MAX_HASH) {}
-
-	void push(const std::string & str) {
-		unsigned code = string_hash(str, MAX_HASH);
-		std::shared_ptr<HashNode> ptr = dict[code];
-		if (ptr) {
-			while (ptr->next())
-				ptr = ptr->next();
-			ptr->setNext(str);
-		}
-		else {
-			dict[code] = std::shared_ptr<HashNode>(new HashNode(str));
-		}
-		++_size;
-	}
-
-	void load(const std::string &dictionary) {
-		std::ifstream file(dictionary);
-		if (file.fail())
-			throw SpellChecker_InvalidDictFile();
-		std::string tmp;
-		while (file >> tmp)
-			push(tmp);
-	}
-
-	bool check(const std::string &word) const {
-		std::string wordLower(word);
-		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
-		std::shared_ptr<HashNode> ptr = dict[string_hash(wordLower, MAX_HASH)];
-		while (ptr) {
-			if (ptr->compare(wordLower))
-				return true;
-			ptr = ptr->next();
-		}
-		return false;
-	}
-	void add(const std::string &word) {
-		std::string wordLower(word);
-		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
-		push(wordLower);
-	}
-	size_t size(void) const { return _size; }
-};
-
-class TrieNode {
-public:
-	TrieNode() = default;
-	bool end = false;
-	TrieNode * next[27] = { nullptr, nullptr, nullptr, nullptr, nullptr,
-	nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
-	nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
-	nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
-	~TrieNode() {
-		for (int i = 0; i < 27; ++i)
-			delete next[i];
-	}
-};
-
-
-class SpellChecker_Trie : public SpellChecker_Impl
-{
-public:
-	inline void load(const std::string &dictionary) {
-		std::ifstream file(dictionary);
-		if (file.fail())
-			throw SpellChecker_InvalidDictFile();
-		std::string word;
-
-		//std::string::const_iterator it;
-		unsigned short index;
-		while (file >> word) {
-			tmp = root;
-			it = word.begin();
-			for (; it != word.end(); ++it) {
-				index = getIndex(*it);
-				if (!tmp->next[index]) {
-					break;
-				}
-				tmp = tmp->next[index];
-			}
-			
-			do {
-				tmp = tmp->next[getIndex(*it)] = (new TrieNode);
-			} while (++it != word.end());
-			tmp->end = true;
-			++_size;
-		}
-		//push(tmp);
-	}
-	inline bool check(const std::string &word) const{
-		tmp = root;
-		for (int i = 0; i < word.size(); ++i) {
-			tmp = tmp->next[getIndex(word[i])];
-			if (!tmp) {
-				return false;
-			}
-		}
-		return tmp->end;
-	}
-	inline void add(const std::string &word) {
-		tmp = root;
-		//std::string::const_iterator 
-		it = word.begin();
-		for (; it != word.end(); ++it) {
-			if (!tmp->next[getIndex((*it))]) {
-				break;
-			}
-			tmp = tmp->next[getIndex((*it))];
-		}
-		
-		if (it == word.end()){
-			if (!tmp->end) {
-				tmp->end = true;
-				++_size;
-			}
-			return;
-		}
-
-		do {
-			tmp = tmp->next[(getIndex(*it))] = (new TrieNode);
-		} while (++it != word.end());
-		tmp->end = true;
-		++_size;
-	}
-	inline size_t size(void) const { return _size; }
-	SpellChecker_Trie() : root(new TrieNode()) {}
-	~SpellChecker_Trie() { delete root; }
+	template <class... Args>
+	explicit SpellChecker_Model(Args &&... args) : checker(std::forward<Args>(args)...) {}
+	void load(const std::string &dictionary) { checker.load(dictionary); }
+	void load_parallel(const std::string &dictionary, unsigned threads) { checker.load_parallel(dictionary, threads); }
+	bool check(const std::string &word) const { return checker.check(word); }
+	SpellChecker_Report check_document(const std::vector<std::string> &tokens, bool dedup) const {
+		return checker.check_document(tokens, dedup);
+	}
+	void add(const std::string &word) { checker.add(word); }
+	bool set_weight(const std::string &word, unsigned weight) { return checker.set_weight(word, weight); }
+	size_t complete(const std::string &prefix, size_t k, std::vector<SpellChecker_Completion> &out,
+		CompletionOrder order) const {
+		return checker.complete(prefix, k, out, order);
+	}
+	size_t size(void) const { return checker.size(); }
+	SpellChecker_Stats stats(void) const { return checker.stats(); }
 private:
-	static TrieNode * tmp ;
-	TrieNode * root;
-	size_t _size = 0;
+	BasicSpellChecker<Engine> checker;
 };
-	TrieNode* SpellChecker_Trie::tmp = nullptr;
 
-SpellChecker::SpellChecker(const enum ContainerType type)
+SpellChecker::SpellChecker(const enum ContainerType type, const MemoryPlacement placement)
 {
 	switch (type)
 	{
 	case ContainerType::Vector:
-		impl_ = std::make_unique<SpellChecker_Vector>();
+		impl_ = std::make_unique<SpellChecker_Model<SpellChecker_Vector>>();
 		break;
 	case ContainerType::Set:
-		impl_ = std::make_unique<SpellChecker_Set>();
+		impl_ = std::make_unique<SpellChecker_Model<SpellChecker_Set>>();
 		break;
 	case ContainerType::Unordered_Set:
-		impl_ = std::make_unique<SpellChecker_UnorderedSet>();
+		impl_ = std::make_unique<SpellChecker_Model<SpellChecker_UnorderedSet>>();
 		break;
 	case ContainerType::CustomHashTable:
-		impl_ = std::make_unique<SpellChecker_CustomHashTable>();
+		impl_ = std::make_unique<SpellChecker_Model<SpellChecker_CustomHashTable>>();
 		break;
 	case ContainerType::Trie:
-		impl_ = std::make_unique<SpellChecker_Trie>();
+		impl_ = std::make_unique<SpellChecker_Model<SpellChecker_Trie>>(placement);
+		break;
+	case ContainerType::AdaptiveRadixTree:
+		impl_ = std::make_unique<SpellChecker_Model<SpellChecker_ART>>();
+		break;
+	case ContainerType::FrontCoded:
+		impl_ = std::make_unique<SpellChecker_Model<SpellChecker_FrontCoded>>();
 		break;
 	case ContainerType::Fastest:
-		impl_ = std::make_unique<SpellChecker_Trie>();
+		impl_ = std::make_unique<SpellChecker_Model<SpellChecker_Trie>>(placement);
 		break;
 	}
 }
 
+SpellChecker::~SpellChecker() = default;
+
 // Loads dictionary into memory. Throws exception if any issues
 void SpellChecker::load(const std::string &dictionary) {
 	impl_->load(dictionary);
 }
 
+// Loads dictionary using given number of threads (0 - hardware concurrency)
+void SpellChecker::load_parallel(const std::string &dictionary, unsigned threads) {
+	impl_->load_parallel(dictionary, threads);
+}
+
 // returns true if word is in dictionary else false
 bool SpellChecker::check(const std::string &word) const {
 	return impl_->check(word);
 }
 
+// checks every token of document, optionally checking distinct tokens once
+SpellChecker_Report SpellChecker::check_document(const std::vector<std::string> &tokens, bool dedup) const {
+	return impl_->check_document(tokens, dedup);
+}
+
 // adds word to dictionary in-memory
 void SpellChecker::add(const std::string &word) {
+	size_t before = impl_->size();
 	impl_->add(word);
+	if (journal_ && impl_->size() != before) {
+		std::string wordLower(word);
+		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
+		journal_->append(wordLower);
+	}
+}
+
+// Opens journal persisting added words and replays words it already holds
+void SpellChecker::open_journal(const std::string &journal, const std::string &dictionary,
+	size_t group_size, size_t compact_after) {
+	journal_.reset();
+	std::unique_ptr<SpellChecker_Journal> opened(
+		new SpellChecker_Journal(journal, dictionary, group_size, compact_after));
+	for (const std::string &word : opened->replay())
+		impl_->add(word);
+	journal_ = std::move(opened);
+}
+
+// syncs words added since last group commit
+void SpellChecker::sync_journal() {
+	if (journal_)
+		journal_->sync();
+}
+
+// merges journal into dictionary file now and empties journal
+void SpellChecker::compact_journal() {
+	if (journal_)
+		journal_->compact();
+}
+
+// sets frequency weight of dictionary word used by CompletionOrder::Weight
+bool SpellChecker::set_weight(const std::string &word, unsigned weight) {
+	return impl_->set_weight(word, weight);
+}
+
+// fills out[0..n) with up to k dictionary words starting with prefix and returns n
+size_t SpellChecker::complete(const std::string &prefix, size_t k, std::vector<SpellChecker_Completion> &out,
+	CompletionOrder order) const {
+	return impl_->complete(prefix, k, out, order);
 }
 
 // Returns number of words in dictionary if loaded else 0 if not yet loaded
@@ -319,21 +130,12 @@ size_t SpellChecker::size(void) const {
 	return impl_->size();
 }
 
+// Returns nodes and bytes used by engine (zeros if engine does not track them)
+SpellChecker_Stats SpellChecker::stats(void) const {
+	return impl_->stats();
+}
+
 // is string recognized as word to check for spelling or should be skipped
 bool SpellChecker::is_valid(const std::string &word) {
-	if (!((isalpha(word.back()) || word.back() == '\'') && (isalpha(word[0]))) || word.size() > 45)
-		return false;
-	// for (const char &c : word)
-	// 	if (!isalpha(c) && c != '\'')
-	// 		return false;
-	// it = (word.begin());
-	// do {
-	// 	if (!isalpha(*it) && *it != '\'')
-	// 		return false;
-	// } while (++it != word.end());
-	for (int i = 1; i < word.size() - 1; ++i)
-		if (!(isalpha(word[i]) || word[i] == '\''))
-			return false;
-	
-	return true;
-}
\ No newline at end of file
+	return is_valid_word(word);
+}
@@ -2,23 +2,67 @@
 
 #include <string>
 #include <memory>
+#include <vector>
+#include <functional>
 
-extern const unsigned int MAX_HASH;
-unsigned int string_hash(const std::string &word, unsigned int max);
+// inline so that hash table lookups need no call into spell_checker.cpp
+constexpr unsigned int MAX_HASH = 501037;
+
+inline unsigned int string_hash(const std::string &word, unsigned int max)
+{
+    return std::hash<std::string>()(word) % max;
+}
 
 // exception on failure to load dictionary file
 class SpellChecker_InvalidDictFile
 {
 };
 
-//class SpellChecker_Impl;
+// memory footprint of the loaded dictionary structure
+struct SpellChecker_Stats
+{
+    size_t nodes = 0;  // allocated nodes, 0 if engine is not node based
+    size_t bytes = 0;  // bytes held by nodes and their keys
+};
+
+// result of spell checking a whole tokenized document
+struct SpellChecker_Report
+{
+    size_t total = 0;             // number of tokens
+    size_t valid = 0;             // tokens recognized as words
+    size_t misspelled = 0;        // misspelled occurrences
+    std::vector<size_t> offsets;  // token indices of misspelled occurrences
+};
+
+// completion candidate filled in by complete()
+struct SpellChecker_Completion
+{
+    std::string word;
+    unsigned weight = 0;
+};
+
+enum class CompletionOrder
+{
+    Lexicographic,
+    Weight  // heaviest first, ties in lexicographic order
+};
+
+class SpellChecker_Journal;
+
+// type-erased engine behind SpellChecker, see BasicSpellChecker
 class SpellChecker_Impl
 {
   public:
     virtual void load(const std::string &dictionary) = 0;
+    virtual void load_parallel(const std::string &dictionary, unsigned threads) = 0;
     virtual bool check(const std::string &word) const = 0;
+    virtual SpellChecker_Report check_document(const std::vector<std::string> &tokens, bool dedup) const = 0;
     virtual void add(const std::string &word) = 0;
+    virtual bool set_weight(const std::string &word, unsigned weight) = 0;
+    virtual size_t complete(const std::string &prefix, size_t k, std::vector<SpellChecker_Completion> &out,
+                            CompletionOrder order) const = 0;
     virtual size_t size(void) const = 0;
+    virtual SpellChecker_Stats stats(void) const = 0;
     virtual ~SpellChecker_Impl() {}
 };
 
@@ -29,29 +73,76 @@ enum class ContainerType
     Unordered_Set,
     CustomHashTable,
     Trie,
+    AdaptiveRadixTree,
+    FrontCoded,
     Fastest // can be CustomHashTable, Trie or any other self-made implementation
 };
 
+// where dictionary structures live in memory (honored by Trie engine)
+enum class MemoryPlacement
+{
+    Heap,           // one heap allocation per node
+    HugePages,      // node arenas on explicit or transparent huge pages
+    NumaReplicated  // huge page arenas with a read-only copy per NUMA node
+};
+
 class SpellChecker
 {
   public:
-    SpellChecker(const ContainerType type);
+    SpellChecker(const ContainerType type, const MemoryPlacement placement = MemoryPlacement::Heap);
+    ~SpellChecker();
 
     // Loads dictionary into memory. Throws exception if any issues
     void load(const std::string &dictionary);
 
+    // Loads dictionary using given number of threads (0 - hardware concurrency)
+    void load_parallel(const std::string &dictionary, unsigned threads = 0);
+
     // returns true if word is in dictionary else false
     bool check(const std::string &word) const;
 
-    // adds word to dictionary in-memory
+    // checks every token of document; with dedup each distinct token
+    // is validated and looked up once and results are expanded back. Dedup
+    // costs a hash probe per token, so it only pays off for engines with
+    // slower lookup (Vector, Set)
+    SpellChecker_Report check_document(const std::vector<std::string> &tokens, bool dedup = false) const;
+
+    // adds word to dictionary in-memory (and to journal if one is open)
     void add(const std::string &word);
 
+    // Opens journal persisting added words and replays words it already
+    // holds. Words are synced in groups of group_size; once journal holds
+    // more than compact_after words they are merged into dictionary file
+    // (0 - never). Throws SpellChecker_JournalError on I/O failure
+    void open_journal(const std::string &journal, const std::string &dictionary,
+                      size_t group_size = 64, size_t compact_after = 1 << 16);
+
+    // syncs words added since last group commit
+    void sync_journal();
+
+    // merges journal into dictionary file now and empties journal
+    void compact_journal();
+
+    // sets frequency weight of dictionary word used by CompletionOrder::Weight,
+    // returns false if word is not in dictionary or engine keeps no weights
+    bool set_weight(const std::string &word, unsigned weight);
+
+    // fills out[0..n) with up to k dictionary words starting with prefix and
+    // returns n; out is never shrunk so a reused vector does not reallocate.
+    // Engines without ordered structure (vector, hash tables) return 0
+    size_t complete(const std::string &prefix, size_t k, std::vector<SpellChecker_Completion> &out,
+                    CompletionOrder order = CompletionOrder::Lexicographic) const;
+
     // Returns number of words in dictionary if loaded else 0 if not yet loaded
     size_t size(void) const;
 
+    // Returns nodes and bytes used by engine (zeros if engine does not track them)
+    SpellChecker_Stats stats(void) const;
+
     // is string recognized as word to check for spelling or should be skipped
     static bool is_valid(const std::string &word);
 
   private:
     std::unique_ptr<SpellChecker_Impl> impl_;
+    std::unique_ptr<SpellChecker_Journal> journal_;
 };
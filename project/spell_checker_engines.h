@@ -0,0 +1,1406 @@
+#pragma once
+
+// Concrete dictionary engines. They share no base class so that
+// BasicSpellChecker<Engine> can call them directly and inline the hot path.
+
+#include "spell_checker.h"
+#include <vector>
+#include <set>
+#include <memory>
+#include <unordered_set>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <utility>
+#include <new>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sched.h>
+#include <pthread.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// helpers shared by the engines, not part of the public interface
+namespace spell_checker_detail {
+
+inline int getIndex(char c) {
+	return (c != '\'' ? c & ~0x60 : 0);
+}
+
+// only these characters have a getIndex() symbol
+inline bool isWordChar(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '\'';
+}
+
+inline char getChar(int index) {
+	return index ? char('a' + index - 1) : '\'';
+}
+
+// longest completion enumerated, anything deeper is not a valid word
+const size_t MAX_COMPLETION = 64;
+
+inline std::vector<std::string> read_words(const std::string &dictionary) {
+	std::ifstream file(dictionary);
+	if (file.fail())
+		throw SpellChecker_InvalidDictFile();
+	std::vector<std::string> words;
+	std::string tmp;
+	while (file >> tmp)
+		words.push_back(tmp);
+	return words;
+}
+
+inline unsigned thread_count(unsigned threads, unsigned parts) {
+	if (!threads)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	return std::min(threads, parts);
+}
+
+// runs worker(t) on threads-1 extra threads and the calling one
+template <class Worker>
+void run_threads(unsigned threads, Worker worker) {
+	std::vector<std::thread> pool;
+	for (unsigned t = 1; t < threads; ++t)
+		pool.emplace_back(worker, t);
+	worker(0);
+	for (auto &th : pool)
+		th.join();
+}
+
+} // namespace spell_checker_detail
+
+// gathers completions straight into caller storage. Lexicographic order
+// stops after k words; weight order keeps a min-heap of the k heaviest
+// seen so far and lets walks skip subtrees that cannot beat its minimum.
+// Strings are assigned in place and keep their capacity.
+class CompletionSink {
+public:
+	CompletionSink(SpellChecker_Completion *out, size_t k, CompletionOrder order) : out(out), k(k), order(order) {}
+	// false if a subtree whose heaviest word weighs max_weight cannot contribute
+	bool wants(unsigned max_weight) const {
+		return order == CompletionOrder::Lexicographic || n < k || max_weight > out[0].weight;
+	}
+	// returns false once no further completions are wanted
+	bool push(const char *word, size_t len, unsigned weight) {
+		if (order == CompletionOrder::Lexicographic) {
+			out[n].word.assign(word, len);
+			out[n].weight = weight;
+			return ++n < k;
+		}
+		// words come in lexicographic order, so an equal weight never wins
+		if (n == k) {
+			if (weight <= out[0].weight)
+				return true;
+			std::pop_heap(out, out + n, heavier);
+			--n;
+		}
+		out[n].word.assign(word, len);
+		out[n].weight = weight;
+		std::push_heap(out, out + ++n, heavier);
+		return true;
+	}
+	size_t finish() {
+		if (order == CompletionOrder::Weight)
+			std::sort_heap(out, out + n, heavier);
+		return n;
+	}
+private:
+	static bool heavier(const SpellChecker_Completion &a, const SpellChecker_Completion &b) {
+		return a.weight != b.weight ? a.weight > b.weight : a.word < b.word;
+	}
+	SpellChecker_Completion *out;
+	size_t k;
+	size_t n = 0;
+	CompletionOrder order;
+};
+
+class SpellChecker_Vector final
+{
+public:
+	SpellChecker_Vector() : dict(27) {}
+	void load(const std::string &dictionary) {
+		std::ifstream file(dictionary);
+		if (file.fail())
+			throw SpellChecker_InvalidDictFile();
+		std::string tmp;
+		while (file >> tmp)
+			dict[spell_checker_detail::getIndex(tmp[0])].push_back(tmp);
+	}
+	bool check(const std::string &word) const {
+		std::string wordLower(word);
+		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
+		const std::vector<std::string> &v = dict[spell_checker_detail::getIndex(wordLower[0])];
+		for (int i = 0; i < v.size(); ++i)
+			if (v[i] == wordLower)
+				return true;
+		return false;
+	}
+	void add(const std::string &word) {
+		std::string wordLower(word);
+		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
+		if (!check(wordLower))
+			dict[spell_checker_detail::getIndex(wordLower[0])].push_back(wordLower);
+	}
+	size_t size(void) const { 
+		size_t res = 0;
+		for (int i = 0; i < dict.size(); ++i)
+			res += dict[i].size();
+		return res; }
+	void load_parallel(const std::string &dictionary, unsigned threads) { load(dictionary); }
+	bool set_weight(const std::string &word, unsigned weight) { return false; }
+	void complete(const std::string &prefix, CompletionSink &sink) const {}
+	SpellChecker_Stats stats(void) const { return SpellChecker_Stats(); }
+private:
+	std::vector<std::vector<std::string>> dict;
+};
+
+class SpellChecker_Set final
+{
+public:
+	void load(const std::string &dictionary) {
+		std::ifstream file(dictionary);
+		if (file.fail())
+			throw SpellChecker_InvalidDictFile();
+		std::string tmp;
+		while (file >> tmp)
+			dict.insert(tmp);
+	}
+	bool check(const std::string &word) const {
+		std::string wordLower(word);
+		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
+		return dict.find(wordLower) != dict.end();
+	}
+	void add(const std::string &word) {
+		std::string wordLower(word);
+		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
+		dict.insert(wordLower);
+	}
+	size_t size(void) const { return dict.size(); }
+	void load_parallel(const std::string &dictionary, unsigned threads) { load(dictionary); }
+	bool set_weight(const std::string &word, unsigned weight) { return false; }
+	// words sharing the prefix are a contiguous range of the sorted set
+	void complete(const std::string &prefix, CompletionSink &sink) const {
+		char buf[spell_checker_detail::MAX_COMPLETION];
+		size_t len = prefix.size();
+		if (len >= spell_checker_detail::MAX_COMPLETION)
+			return;
+		std::transform(prefix.begin(), prefix.end(), buf, ::tolower);
+		for (auto i = dict.lower_bound(std::string(buf, len)); i != dict.end(); ++i)
+			if (i->compare(0, len, buf, len) || !sink.wants(0) || !sink.push(i->data(), i->size(), 0))
+				break;
+	}
+	SpellChecker_Stats stats(void) const { return SpellChecker_Stats(); }
+private:
+	std::set<std::string> dict;
+};
+
+class SpellChecker_UnorderedSet final
+{
+public:
+	void load(const std::string &dictionary) {
+		std::ifstream file(dictionary);
+		if (file.fail())
+			throw SpellChecker_InvalidDictFile();
+		std::string tmp;
+		while (file >> tmp)
+			dict.insert(tmp);
+	}
+	bool check(const std::string &word) const {
+		std::string wordLower(word);
+		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
+		return dict.find(wordLower) != dict.end();
+	}
+	void add(const std::string &word) {
+		std::string wordLower(word);
+		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
+		dict.insert(wordLower);
+	}
+	size_t size(void) const { return dict.size(); }
+	void load_parallel(const std::string &dictionary, unsigned threads) { load(dictionary); }
+	bool set_weight(const std::string &word, unsigned weight) { return false; }
+	void complete(const std::string &prefix, CompletionSink &sink) const {}
+	SpellChecker_Stats stats(void) const { return SpellChecker_Stats(); }
+private:
+	std::unordered_set<std::string> dict;
+};
+
+class HashNode {
+public:
+	HashNode() = default;
+	HashNode(const std::string &str) : _str(str) {}
+	std::shared_ptr<HashNode> next() {
+		return _next;
+	}
+	void setNext(const std::string &str) {
+		_next = std::shared_ptr<HashNode>(new HashNode(str));
+	}
+	void setString(const std::string &str) {
+		_str = str;
+	}
+	bool isEmpty() {
+		return _str != "";
+	}
+	std::string str() {
+		return _str;
+	}
+	bool compare(const std::string &str) {
+		return _str == str;
+	}
+private:
+	std::string _str;
+	std::shared_ptr<HashNode> _next;
+};
+
+class SpellChecker_CustomHashTable final
+{
+private:
+	std::vector<std::shared_ptr<HashNode>> dict;
+	size_t _size = 0;
+public:
+	SpellChecker_CustomHashTable() : dict(MAX_HASH) {}
+
+	void link(unsigned code, const std::string & str) {
+		std::shared_ptr<HashNode> ptr = dict[code];
+		if (ptr) {
+			while (ptr->next())
+				ptr = ptr->next();
+			ptr->setNext(str);
+		}
+		else {
+			dict[code] = std::shared_ptr<HashNode>(new HashNode(str));
+		}
+	}
+
+	void push(const std::string & str) {
+		link(string_hash(str, MAX_HASH), str);
+		++_size;
+	}
+
+	void load(const std::string &dictionary) {
+		std::ifstream file(dictionary);
+		if (file.fail())
+			throw SpellChecker_InvalidDictFile();
+		std::string tmp;
+		while (file >> tmp)
+			push(tmp);
+	}
+
+	// each thread hashes a chunk of words and scatters them by owning
+	// bucket range; then each thread links the words of its own range,
+	// visiting chunks in file order so chains match the serial load
+	void load_parallel(const std::string &dictionary, unsigned threads) {
+		std::vector<std::string> words = spell_checker_detail::read_words(dictionary);
+		threads = spell_checker_detail::thread_count(threads, MAX_HASH);
+		struct Entry {
+			unsigned code;
+			unsigned index;
+		};
+		// ranges[chunk][range] - words of chunk whose bucket falls into range
+		std::vector<std::vector<std::vector<Entry>>> ranges(threads, std::vector<std::vector<Entry>>(threads));
+		spell_checker_detail::run_threads(threads, [&](unsigned t) {
+			size_t from = words.size() * t / threads, to = words.size() * (t + 1) / threads;
+			for (size_t i = from; i < to; ++i) {
+				unsigned code = string_hash(words[i], MAX_HASH);
+				ranges[t][code * (unsigned long long)threads / MAX_HASH].push_back({ code, (unsigned)i });
+			}
+		});
+		spell_checker_detail::run_threads(threads, [&](unsigned t) {
+			for (unsigned chunk = 0; chunk < threads; ++chunk)
+				for (const Entry &entry : ranges[chunk][t])
+					link(entry.code, words[entry.index]);
+		});
+		_size += words.size();
+	}
+
+	bool check(const std::string &word) const {
+		std::string wordLower(word);
+		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
+		std::shared_ptr<HashNode> ptr = dict[string_hash(wordLower, MAX_HASH)];
+		while (ptr) {
+			if (ptr->compare(wordLower))
+				return true;
+			ptr = ptr->next();
+		}
+		return false;
+	}
+	void add(const std::string &word) {
+		std::string wordLower(word);
+		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
+		push(wordLower);
+	}
+	size_t size(void) const { return _size; }
+	bool set_weight(const std::string &word, unsigned weight) { return false; }
+	void complete(const std::string &prefix, CompletionSink &sink) const {}
+	SpellChecker_Stats stats(void) const { return SpellChecker_Stats(); }
+};
+
+class TrieNode {
+public:
+	TrieNode() = default;
+	bool end = false;
+	unsigned weight = 0;
+	unsigned max_weight = 0; // upper bound of weights in this subtree
+	TrieNode * next[27] = { nullptr, nullptr, nullptr, nullptr, nullptr,
+	nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+	nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+	nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+	~TrieNode() {
+		for (int i = 0; i < 27; ++i)
+			delete next[i];
+	}
+};
+
+
+// bump allocator over 2MB chunks backed by explicit huge pages when
+// reserved, otherwise by transparent huge pages via madvise; plain heap
+// chunks where mmap is not available
+class NodeArena {
+public:
+	static const size_t CHUNK = 2 << 20;
+	NodeArena() = default;
+	NodeArena(const NodeArena &) = delete;
+	NodeArena &operator=(const NodeArena &) = delete;
+	void *allocate(size_t bytes) {
+		if (!cur || cur + bytes > end)
+			grow();
+		void *res = cur;
+		cur += bytes;
+		return res;
+	}
+	~NodeArena() {
+		for (void *chunk : chunks)
+#ifdef __linux__
+			munmap(chunk, CHUNK);
+#else
+			::operator delete(chunk);
+#endif
+	}
+private:
+	static void *map_chunk() {
+#ifndef __linux__
+		return ::operator new(CHUNK);
+#else
+		void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+		p = mmap(nullptr, CHUNK, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED)
+			return p;
+#endif
+		// over-map and trim so that the chunk is huge page aligned
+		p = mmap(nullptr, 2 * CHUNK, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+			throw std::bad_alloc();
+		uintptr_t addr = reinterpret_cast<uintptr_t>(p);
+		uintptr_t aligned = (addr + CHUNK - 1) & ~(uintptr_t)(CHUNK - 1);
+		if (aligned != addr)
+			munmap(p, aligned - addr);
+		munmap(reinterpret_cast<void *>(aligned + CHUNK), addr + CHUNK - aligned);
+		p = reinterpret_cast<void *>(aligned);
+#ifdef MADV_HUGEPAGE
+		madvise(p, CHUNK, MADV_HUGEPAGE);
+#endif
+		return p;
+#endif
+	}
+	void grow() {
+		chunks.push_back(map_chunk());
+		cur = static_cast<char *>(chunks.back());
+		end = cur + CHUNK;
+	}
+	std::vector<void *> chunks;
+	char *cur = nullptr;
+	char *end = nullptr;
+};
+
+// NUMA nodes and their cpus as listed in sysfs; single node if unknown.
+// Tests build it from a fake sysfs directory and pin the current node.
+class NumaTopology {
+public:
+	static const NumaTopology &get() {
+		static const NumaTopology topology;
+		return topology;
+	}
+	explicit NumaTopology(const std::string &sysfs = "/sys/devices/system/node") {
+		for (unsigned node = 0;; ++node) {
+			std::ifstream file(sysfs + "/node" + std::to_string(node) + "/cpulist");
+			if (file.fail())
+				break;
+			node_cpus.emplace_back();
+			// format is "0-3,8,10-11"
+			int from, to;
+			char sep;
+			while (file >> from) {
+				to = from;
+				if (file.peek() == '-')
+					file >> sep >> to;
+				for (int cpu = from; cpu <= to; ++cpu) {
+					node_cpus.back().push_back(cpu);
+					if (cpu >= (int)cpu_node.size())
+						cpu_node.resize(cpu + 1, 0);
+					cpu_node[cpu] = node;
+				}
+				if (file.peek() == ',')
+					file >> sep;
+			}
+		}
+		if (node_cpus.empty())
+			node_cpus.emplace_back();
+	}
+	size_t nodes() const { return node_cpus.size(); }
+	const std::vector<int> &cpus(unsigned node) const { return node_cpus[node]; }
+	// test hook: report given node as current instead of asking the kernel (-1 - off)
+	void pin_current(int node) { pinned = node; }
+	// cpu is cached per thread and refreshed every 256 calls, as threads rarely migrate
+	unsigned current_node() const {
+		if (pinned >= 0)
+			return pinned;
+		static thread_local int cpu = -1;
+		static thread_local unsigned calls = 0;
+		if (nodes() < 2)
+			return 0;
+#ifdef __linux__
+		if (!(calls++ & 255))
+			cpu = sched_getcpu();
+#endif
+		return cpu >= 0 && cpu < (int)cpu_node.size() ? cpu_node[cpu] : 0;
+	}
+	// restricts calling thread to cpus of given node so pages it touches first are placed there
+	void bind_current_thread(unsigned node) const {
+#ifdef __linux__
+		// best effort, the thread still runs if cpus are offline or unknown
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (int cpu : node_cpus[node])
+			if (cpu < CPU_SETSIZE)
+				CPU_SET(cpu, &set);
+		if (CPU_COUNT(&set))
+			pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+	}
+private:
+	std::vector<std::vector<int>> node_cpus;
+	std::vector<unsigned> cpu_node;
+	int pinned = -1;
+};
+
+// long-lived thread bound to one NUMA node that runs jobs handed to it
+// one at a time; replicas are built and updated through it, so adding a
+// word costs a handoff instead of creating a thread
+class NodeWorker {
+public:
+	NodeWorker(const NumaTopology &numa, unsigned node) : thread([this, &numa, node]() {
+		numa.bind_current_thread(node);
+		serve();
+	}) {}
+	NodeWorker(const NodeWorker &) = delete;
+	NodeWorker &operator=(const NodeWorker &) = delete;
+	~NodeWorker() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		wake.notify_all();
+		thread.join();
+	}
+	// runs fn on the worker and waits for it, rethrowing what it threw
+	void run(const std::function<void()> &fn) {
+		std::unique_lock<std::mutex> lock(mutex);
+		job = &fn;
+		wake.notify_all();
+		wake.wait(lock, [this]() { return !job; });
+		if (error)
+			std::rethrow_exception(std::exchange(error, nullptr));
+	}
+private:
+	void serve() {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			wake.wait(lock, [this]() { return stop || job; });
+			if (!job)
+				return;
+			try {
+				(*job)();
+			}
+			catch (...) {
+				error = std::current_exception();
+			}
+			job = nullptr;
+			wake.notify_all();
+		}
+	}
+	std::mutex mutex;
+	std::condition_variable wake;
+	const std::function<void()> *job = nullptr;
+	std::exception_ptr error;
+	bool stop = false;
+	std::thread thread; // started last, once the members it uses exist
+};
+
+class SpellChecker_Trie final
+{
+public:
+	inline void load(const std::string &dictionary) {
+		std::ifstream file(dictionary);
+		if (file.fail())
+			throw SpellChecker_InvalidDictFile();
+		std::string word;
+
+		TrieNode *tmp;
+		std::string::const_iterator it;
+		unsigned short index;
+		while (file >> word) {
+			tmp = root;
+			it = word.begin();
+			for (; it != word.end(); ++it) {
+				index = spell_checker_detail::getIndex(*it);
+				if (!tmp->next[index]) {
+					break;
+				}
+				tmp = tmp->next[index];
+			}
+			
+			do {
+				tmp = tmp->next[spell_checker_detail::getIndex(*it)] = make_node(spell_checker_detail::getIndex(word[0]));
+			} while (++it != word.end());
+			tmp->end = true;
+			++_size;
+		}
+		//push(tmp);
+		replicate();
+	}
+	// root subtrees are disjoint, so every first letter is built
+	// independently by whichever thread picks it up
+	void load_parallel(const std::string &dictionary, unsigned threads) {
+		std::vector<std::string> words = spell_checker_detail::read_words(dictionary);
+		std::vector<std::vector<const std::string *>> letters(27);
+		for (const std::string &word : words)
+			letters[spell_checker_detail::getIndex(word[0])].push_back(&word);
+
+		threads = spell_checker_detail::thread_count(threads, 27);
+		std::vector<size_t> added(threads, 0);
+		std::atomic<unsigned> letter(0);
+		spell_checker_detail::run_threads(threads, [&](unsigned t) {
+			for (unsigned l; (l = letter++) < 27;)
+				for (const std::string *word : letters[l])
+					added[t] += insert(root, *word);
+		});
+		for (size_t n : added)
+			_size += n;
+		replicate();
+	}
+	inline bool check(const std::string &word) const{
+		const TrieNode *node = local_root();
+		for (int i = 0; i < word.size(); ++i) {
+			node = node->next[spell_checker_detail::getIndex(word[i])];
+			if (!node) {
+				return false;
+			}
+		}
+		return node->end;
+	}
+	inline void add(const std::string &word) {
+		// new nodes of a replica are first touched on its own node
+		for (unsigned node = 0; node < replicas.size(); ++node)
+			if (replicas[node])
+				workers[node]->run([&]() { replicas[node]->add(word); });
+		TrieNode *tmp = root;
+		std::string::const_iterator it = word.begin();
+		for (; it != word.end(); ++it) {
+			if (!tmp->next[spell_checker_detail::getIndex((*it))]) {
+				break;
+			}
+			tmp = tmp->next[spell_checker_detail::getIndex((*it))];
+		}
+		
+		if (it == word.end()){
+			if (!tmp->end) {
+				tmp->end = true;
+				++_size;
+			}
+			return;
+		}
+
+		do {
+			tmp = tmp->next[(spell_checker_detail::getIndex(*it))] = make_node(spell_checker_detail::getIndex(word[0]));
+		} while (++it != word.end());
+		tmp->end = true;
+		++_size;
+	}
+	inline size_t size(void) const { return _size; }
+	bool set_weight(const std::string &word, unsigned weight) {
+		if (!std::all_of(word.begin(), word.end(), spell_checker_detail::isWordChar))
+			return false;
+		for (auto &replica : replicas)
+			if (replica)
+				replica->set_weight(word, weight);
+		if (!check(word))
+			return false;
+		TrieNode *node = root;
+		for (size_t i = 0; i < word.size(); ++i) {
+			node->max_weight = std::max(node->max_weight, weight);
+			node = node->next[spell_checker_detail::getIndex(word[i])];
+		}
+		node->max_weight = std::max(node->max_weight, weight);
+		node->weight = weight;
+		return true;
+	}
+	void complete(const std::string &prefix, CompletionSink &sink) const {
+		const TrieNode *node = local_root();
+		char buf[spell_checker_detail::MAX_COMPLETION];
+		if (prefix.size() >= spell_checker_detail::MAX_COMPLETION ||
+			!std::all_of(prefix.begin(), prefix.end(), spell_checker_detail::isWordChar))
+			return;
+		for (size_t i = 0; node && i < prefix.size(); ++i) {
+			buf[i] = spell_checker_detail::getChar(spell_checker_detail::getIndex(prefix[i]));
+			node = node->next[spell_checker_detail::getIndex(prefix[i])];
+		}
+		if (node)
+			collect(node, buf, prefix.size(), sink);
+	}
+	SpellChecker_Stats stats(void) const {
+		SpellChecker_Stats res;
+		res.nodes = count_nodes(root);
+		res.bytes = res.nodes * sizeof(TrieNode);
+		return res;
+	}
+	// numa defaults to the machine topology
+	SpellChecker_Trie(MemoryPlacement placement = MemoryPlacement::Heap, const NumaTopology *numa = nullptr)
+		: root(new TrieNode()), placement(placement), arenas(placement == MemoryPlacement::Heap ? 0 : 27),
+		numa(numa ? numa : &NumaTopology::get()) {}
+	// owns its nodes: movable, not copyable; a moved-from trie may only be destroyed
+	SpellChecker_Trie(const SpellChecker_Trie &) = delete;
+	SpellChecker_Trie &operator=(const SpellChecker_Trie &) = delete;
+	SpellChecker_Trie(SpellChecker_Trie &&other) noexcept
+		: root(other.root), _size(other._size), placement(other.placement), arenas(std::move(other.arenas)),
+		numa(other.numa), workers(std::move(other.workers)), replicas(std::move(other.replicas)) {
+		other.root = nullptr;
+		other._size = 0;
+	}
+	~SpellChecker_Trie() {
+		if (!root)
+			return;
+		// arena nodes are released with their chunks
+		if (!arenas.empty())
+			std::fill(std::begin(root->next), std::end(root->next), nullptr);
+		delete root;
+	}
+private:
+	// load_parallel helper, thread-safe as long as no other thread touches the same subtree
+	bool insert(TrieNode *node, const std::string &word) {
+		std::string::const_iterator pos = word.begin();
+		for (; pos != word.end() && node->next[spell_checker_detail::getIndex(*pos)]; ++pos)
+			node = node->next[spell_checker_detail::getIndex(*pos)];
+		for (; pos != word.end(); ++pos)
+			node = node->next[spell_checker_detail::getIndex(*pos)] = make_node(spell_checker_detail::getIndex(word[0]));
+		if (node->end)
+			return false;
+		node->end = true;
+		return true;
+	}
+	// each root subtree gets its own arena, so the parallel build needs no locking
+	TrieNode *make_node(int letter) {
+		if (arenas.empty())
+			return new TrieNode;
+		if (!arenas[letter])
+			arenas[letter].reset(new NodeArena);
+		return new (arenas[letter]->allocate(sizeof(TrieNode))) TrieNode;
+	}
+	const TrieNode *local_root() const {
+		if (!replicas.empty() && replicas[numa->current_node()])
+			return replicas[numa->current_node()]->root;
+		return root;
+	}
+	// depth first walk visits children in symbol order, i.e. lexicographically
+	static bool collect(const TrieNode *node, char *buf, size_t len, CompletionSink &sink) {
+		if (!sink.wants(node->max_weight))
+			return true;
+		if (node->end && !sink.push(buf, len, node->weight))
+			return false;
+		if (len == spell_checker_detail::MAX_COMPLETION)
+			return true;
+		for (int i = 0; i < 27; ++i) {
+			if (!node->next[i])
+				continue;
+			buf[len] = spell_checker_detail::getChar(i);
+			if (!collect(node->next[i], buf, len + 1, sink))
+				return false;
+		}
+		return true;
+	}
+	static size_t count_nodes(const TrieNode *node) {
+		size_t res = 1;
+		for (int i = 0; i < 27; ++i)
+			if (node->next[i])
+				res += count_nodes(node->next[i]);
+		return res;
+	}
+	TrieNode *clone(const TrieNode *src, int letter) {
+		TrieNode *node = make_node(letter);
+		node->end = src->end;
+		node->weight = src->weight;
+		node->max_weight = src->max_weight;
+		for (int i = 0; i < 27; ++i)
+			if (src->next[i])
+				node->next[i] = clone(src->next[i], letter);
+		return node;
+	}
+	// copies the loaded trie into every other NUMA node; the node the load ran on keeps the original
+	void replicate() {
+		if (placement != MemoryPlacement::NumaReplicated || numa->nodes() < 2)
+			return;
+		replicas.clear();
+		replicas.resize(numa->nodes());
+		workers.resize(numa->nodes());
+		unsigned home = numa->current_node();
+		for (unsigned node = 0; node < numa->nodes(); ++node) {
+			if (node == home)
+				continue;
+			if (!workers[node])
+				workers[node].reset(new NodeWorker(*numa, node));
+			workers[node]->run([&]() {
+				replicas[node].reset(new SpellChecker_Trie(MemoryPlacement::HugePages, numa));
+				for (int i = 0; i < 27; ++i)
+					if (root->next[i])
+						replicas[node]->root->next[i] = replicas[node]->clone(root->next[i], i);
+				replicas[node]->root->end = root->end;
+				replicas[node]->root->weight = root->weight;
+				replicas[node]->root->max_weight = root->max_weight;
+				replicas[node]->_size = _size;
+			});
+		}
+	}
+	TrieNode * root;
+	size_t _size = 0;
+	MemoryPlacement placement;
+	std::vector<std::unique_ptr<NodeArena>> arenas;
+	const NumaTopology *numa;
+	std::vector<std::unique_ptr<NodeWorker>> workers; // per replica node, outlive replicas
+	std::vector<std::unique_ptr<SpellChecker_Trie>> replicas;
+};
+
+// Adaptive radix tree over spell_checker_detail::getIndex() symbols. Nodes grow Leaf -> Node4 ->
+// Node16 -> Node27; since the alphabet has only 27 symbols the direct
+// indexed Node27 takes the place of ART's Node48/Node256. Single child
+// chains are collapsed into a prefix of up to ART_PREFIX symbols.
+const int ART_PREFIX = 4;
+
+struct ArtNode {
+	enum : unsigned char { Leaf, Node4, Node16, Node27 };
+	unsigned char type = Leaf;
+	unsigned char count = 0;
+	unsigned char prefix_len = 0;
+	bool end = false;
+	unsigned char prefix[ART_PREFIX];
+	unsigned weight = 0;
+	unsigned max_weight = 0; // upper bound of weights in this subtree
+};
+
+struct ArtNode4 : ArtNode {
+	unsigned char keys[4];
+	ArtNode *children[4];
+};
+
+struct ArtNode16 : ArtNode {
+	unsigned char keys[16];
+	ArtNode *children[16];
+};
+
+struct ArtNode27 : ArtNode {
+	ArtNode *children[27] = {};
+};
+
+class SpellChecker_ART final
+{
+public:
+	SpellChecker_ART() = default;
+	// owns its nodes: movable, not copyable
+	SpellChecker_ART(const SpellChecker_ART &) = delete;
+	SpellChecker_ART &operator=(const SpellChecker_ART &) = delete;
+	SpellChecker_ART(SpellChecker_ART &&other) noexcept : root(other.root), _size(other._size) {
+		other.root = nullptr;
+		other._size = 0;
+	}
+	~SpellChecker_ART() { destroy(root); }
+	void load(const std::string &dictionary) {
+		std::ifstream file(dictionary);
+		if (file.fail())
+			throw SpellChecker_InvalidDictFile();
+		std::string tmp;
+		while (file >> tmp)
+			add(tmp);
+	}
+	bool check(const std::string &word) const {
+		const ArtNode *node = root;
+		size_t i = 0, len = word.size();
+		while (node) {
+			if (node->prefix_len) {
+				if (len - i < node->prefix_len)
+					return false;
+				for (int j = 0; j < node->prefix_len; ++j)
+					if (node->prefix[j] != spell_checker_detail::getIndex(word[i + j]))
+						return false;
+				i += node->prefix_len;
+			}
+			if (i == len)
+				return node->end;
+			node = find_child(node, spell_checker_detail::getIndex(word[i++]));
+		}
+		return false;
+	}
+	// words with characters outside [A-Za-z'] are not stored
+	void add(const std::string &word) {
+		if (!std::all_of(word.begin(), word.end(), spell_checker_detail::isWordChar))
+			return;
+		std::vector<unsigned char> key(word.size());
+		std::transform(word.begin(), word.end(), key.begin(), spell_checker_detail::getIndex);
+		if (insert(root, key.data(), key.size()))
+			++_size;
+	}
+	size_t size(void) const { return _size; }
+	void load_parallel(const std::string &dictionary, unsigned threads) { load(dictionary); }
+	bool set_weight(const std::string &word, unsigned weight) {
+		if (!std::all_of(word.begin(), word.end(), spell_checker_detail::isWordChar))
+			return false;
+		ArtNode *node = weigh_path(word, weight);
+		if (!node)
+			return false;
+		node->weight = weight;
+		return true;
+	}
+	void complete(const std::string &prefix, CompletionSink &sink) const {
+		char buf[spell_checker_detail::MAX_COMPLETION];
+		const ArtNode *node = root;
+		size_t i = 0, len = prefix.size();
+		if (len >= spell_checker_detail::MAX_COMPLETION ||
+			!std::all_of(prefix.begin(), prefix.end(), spell_checker_detail::isWordChar))
+			return;
+		for (size_t j = 0; j < len; ++j)
+			buf[j] = spell_checker_detail::getChar(spell_checker_detail::getIndex(prefix[j]));
+		while (node) {
+			// prefix may end inside the compressed path of this node
+			size_t j = 0;
+			for (; j < node->prefix_len && i + j < len; ++j)
+				if (node->prefix[j] != spell_checker_detail::getIndex(prefix[i + j]))
+					return;
+			if (i + node->prefix_len >= len) {
+				if (i + node->prefix_len >= spell_checker_detail::MAX_COMPLETION)
+					return;
+				for (; j < node->prefix_len; ++j)
+					buf[i + j] = spell_checker_detail::getChar(node->prefix[j]);
+				collect(node, buf, i + node->prefix_len, sink);
+				return;
+			}
+			i += node->prefix_len;
+			node = find_child(node, spell_checker_detail::getIndex(prefix[i++]));
+		}
+	}
+	SpellChecker_Stats stats(void) const {
+		SpellChecker_Stats res;
+		count(root, res);
+		return res;
+	}
+private:
+	// finds node ending word, raising max_weight along the path when it exists
+	ArtNode *weigh_path(const std::string &word, unsigned weight) {
+		if (!check(word))
+			return nullptr;
+		ArtNode *node = root;
+		size_t i = 0, len = word.size();
+		while (node) {
+			node->max_weight = std::max(node->max_weight, weight);
+			if (len - i < node->prefix_len)
+				return nullptr;
+			for (int j = 0; j < node->prefix_len; ++j)
+				if (node->prefix[j] != spell_checker_detail::getIndex(word[i + j]))
+					return nullptr;
+			i += node->prefix_len;
+			if (i == len)
+				return node->end ? node : nullptr;
+			node = find_child(node, spell_checker_detail::getIndex(word[i++]));
+		}
+		return nullptr;
+	}
+	// buf holds the word up to and including node's prefix; children are
+	// visited in key order, so words come out lexicographically
+	static bool collect(const ArtNode *node, char *buf, size_t len, CompletionSink &sink) {
+		if (!sink.wants(node->max_weight))
+			return true;
+		if (node->end && !sink.push(buf, len, node->weight))
+			return false;
+		auto visit = [&](unsigned char key, const ArtNode *child) {
+			size_t depth = len + 1 + child->prefix_len;
+			if (depth > spell_checker_detail::MAX_COMPLETION)
+				return true;
+			buf[len] = spell_checker_detail::getChar(key);
+			for (int j = 0; j < child->prefix_len; ++j)
+				buf[len + 1 + j] = spell_checker_detail::getChar(child->prefix[j]);
+			return collect(child, buf, depth, sink);
+		};
+		switch (node->type) {
+		case ArtNode::Node4: {
+			const ArtNode4 *n = static_cast<const ArtNode4 *>(node);
+			for (int i = 0; i < n->count; ++i)
+				if (!visit(n->keys[i], n->children[i]))
+					return false;
+			break;
+		}
+		case ArtNode::Node16: {
+			const ArtNode16 *n = static_cast<const ArtNode16 *>(node);
+			for (int i = 0; i < n->count; ++i)
+				if (!visit(n->keys[i], n->children[i]))
+					return false;
+			break;
+		}
+		case ArtNode::Node27: {
+			const ArtNode27 *n = static_cast<const ArtNode27 *>(node);
+			for (int i = 0; i < 27; ++i)
+				if (n->children[i] && !visit(i, n->children[i]))
+					return false;
+			break;
+		}
+		}
+		return true;
+	}
+	static ArtNode *find_child(const ArtNode *node, unsigned char c) {
+		switch (node->type) {
+		case ArtNode::Node4: {
+			const ArtNode4 *n = static_cast<const ArtNode4 *>(node);
+			for (int i = 0; i < n->count; ++i)
+				if (n->keys[i] == c)
+					return n->children[i];
+			return nullptr;
+		}
+		case ArtNode::Node16: {
+			const ArtNode16 *n = static_cast<const ArtNode16 *>(node);
+#ifdef __SSE2__
+			__m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(c), _mm_loadu_si128((const __m128i *)n->keys));
+			unsigned mask = _mm_movemask_epi8(cmp) & ((1u << n->count) - 1);
+			return mask ? n->children[__builtin_ctz(mask)] : nullptr;
+#else
+			for (int i = 0; i < n->count; ++i)
+				if (n->keys[i] == c)
+					return n->children[i];
+			return nullptr;
+#endif
+		}
+		case ArtNode::Node27:
+			return c < 27 ? static_cast<const ArtNode27 *>(node)->children[c] : nullptr;
+		}
+		return nullptr;
+	}
+	static ArtNode **find_child_ref(ArtNode *node, unsigned char c) {
+		switch (node->type) {
+		case ArtNode::Node4: {
+			ArtNode4 *n = static_cast<ArtNode4 *>(node);
+			for (int i = 0; i < n->count; ++i)
+				if (n->keys[i] == c)
+					return &n->children[i];
+			return nullptr;
+		}
+		case ArtNode::Node16: {
+			ArtNode16 *n = static_cast<ArtNode16 *>(node);
+			for (int i = 0; i < n->count; ++i)
+				if (n->keys[i] == c)
+					return &n->children[i];
+			return nullptr;
+		}
+		case ArtNode::Node27: {
+			ArtNode27 *n = static_cast<ArtNode27 *>(node);
+			return c < 27 && n->children[c] ? &n->children[c] : nullptr;
+		}
+		}
+		return nullptr;
+	}
+	// keyed nodes keep their keys sorted so that children enumerate in order
+	template <class Node>
+	static void insert_sorted(Node *n, unsigned char c, ArtNode *child) {
+		int i = n->count;
+		for (; i > 0 && n->keys[i - 1] > c; --i) {
+			n->keys[i] = n->keys[i - 1];
+			n->children[i] = n->children[i - 1];
+		}
+		n->keys[i] = c;
+		n->children[i] = child;
+		++n->count;
+	}
+	template <class To, class From>
+	static To *grow(From *from) {
+		To *to = new To;
+		static_cast<ArtNode &>(*to) = *from;
+		to->type = std::is_same<To, ArtNode4>::value ? ArtNode::Node4 :
+			std::is_same<To, ArtNode16>::value ? ArtNode::Node16 : ArtNode::Node27;
+		return to;
+	}
+	static void add_child(ArtNode *&ref, unsigned char c, ArtNode *child) {
+		ArtNode *node = ref;
+		switch (node->type) {
+		case ArtNode::Leaf: {
+			ArtNode4 *n = grow<ArtNode4>(node);
+			delete node;
+			insert_sorted(n, c, child);
+			ref = n;
+			return;
+		}
+		case ArtNode::Node4: {
+			ArtNode4 *n = static_cast<ArtNode4 *>(node);
+			if (n->count < 4)
+				return insert_sorted(n, c, child);
+			ArtNode16 *g = grow<ArtNode16>(n);
+			g->count = 0;
+			for (int i = 0; i < n->count; ++i)
+				insert_sorted(g, n->keys[i], n->children[i]);
+			insert_sorted(g, c, child);
+			delete n;
+			ref = g;
+			return;
+		}
+		case ArtNode::Node16: {
+			ArtNode16 *n = static_cast<ArtNode16 *>(node);
+			if (n->count < 16)
+				return insert_sorted(n, c, child);
+			ArtNode27 *g = grow<ArtNode27>(n);
+			for (int i = 0; i < n->count; ++i)
+				g->children[n->keys[i]] = n->children[i];
+			g->children[c] = child;
+			++g->count;
+			delete n;
+			ref = g;
+			return;
+		}
+		case ArtNode::Node27: {
+			ArtNode27 *n = static_cast<ArtNode27 *>(node);
+			n->children[c] = child;
+			++n->count;
+			return;
+		}
+		}
+	}
+	// builds chain of nodes holding the rest of the key, ending in a leaf
+	static ArtNode *make_leaf(const unsigned char *key, size_t len) {
+		if (len <= ART_PREFIX) {
+			ArtNode *node = new ArtNode;
+			node->prefix_len = (unsigned char)len;
+			std::copy(key, key + len, node->prefix);
+			node->end = true;
+			return node;
+		}
+		ArtNode4 *node = new ArtNode4;
+		node->type = ArtNode::Node4;
+		node->prefix_len = ART_PREFIX;
+		std::copy(key, key + ART_PREFIX, node->prefix);
+		insert_sorted(node, key[ART_PREFIX], make_leaf(key + ART_PREFIX + 1, len - ART_PREFIX - 1));
+		return node;
+	}
+	static bool insert(ArtNode *&ref, const unsigned char *key, size_t len) {
+		ArtNode *node = ref;
+		if (!node) {
+			ref = make_leaf(key, len);
+			return true;
+		}
+		size_t p = 0;
+		while (p < node->prefix_len && p < len && node->prefix[p] == key[p])
+			++p;
+		if (p < node->prefix_len) {
+			// split the compressed path where the key diverges
+			ArtNode *parent = new ArtNode;
+			parent->max_weight = node->max_weight;
+			parent->prefix_len = (unsigned char)p;
+			std::copy(node->prefix, node->prefix + p, parent->prefix);
+			unsigned char c = node->prefix[p];
+			node->prefix_len -= (unsigned char)(p + 1);
+			std::copy(node->prefix + p + 1, node->prefix + p + 1 + node->prefix_len, node->prefix);
+			add_child(parent, c, node);
+			if (p == len)
+				parent->end = true;
+			else
+				add_child(parent, key[p], make_leaf(key + p + 1, len - p - 1));
+			ref = parent;
+			return true;
+		}
+		key += p;
+		len -= p;
+		if (!len) {
+			if (node->end)
+				return false;
+			node->end = true;
+			return true;
+		}
+		if (ArtNode **child = find_child_ref(node, key[0]))
+			return insert(*child, key + 1, len - 1);
+		add_child(ref, key[0], make_leaf(key + 1, len - 1));
+		return true;
+	}
+	template <class Fn>
+	static void for_each_child(const ArtNode *node, Fn fn) {
+		switch (node->type) {
+		case ArtNode::Node4:
+			for (int i = 0; i < node->count; ++i)
+				fn(static_cast<const ArtNode4 *>(node)->children[i]);
+			break;
+		case ArtNode::Node16:
+			for (int i = 0; i < node->count; ++i)
+				fn(static_cast<const ArtNode16 *>(node)->children[i]);
+			break;
+		case ArtNode::Node27:
+			for (ArtNode *child : static_cast<const ArtNode27 *>(node)->children)
+				if (child)
+					fn(child);
+			break;
+		}
+	}
+	static size_t node_bytes(const ArtNode *node) {
+		switch (node->type) {
+		case ArtNode::Node4: return sizeof(ArtNode4);
+		case ArtNode::Node16: return sizeof(ArtNode16);
+		case ArtNode::Node27: return sizeof(ArtNode27);
+		}
+		return sizeof(ArtNode);
+	}
+	static void count(const ArtNode *node, SpellChecker_Stats &res) {
+		if (!node)
+			return;
+		++res.nodes;
+		res.bytes += node_bytes(node);
+		for_each_child(node, [&](const ArtNode *child) { count(child, res); });
+	}
+	static void destroy(ArtNode *node) {
+		if (!node)
+			return;
+		for_each_child(node, [](ArtNode *child) { destroy(child); });
+		switch (node->type) {
+		case ArtNode::Node4: delete static_cast<ArtNode4 *>(node); break;
+		case ArtNode::Node16: delete static_cast<ArtNode16 *>(node); break;
+		case ArtNode::Node27: delete static_cast<ArtNode27 *>(node); break;
+		default: delete node;
+		}
+	}
+	ArtNode *root = nullptr;
+	size_t _size = 0;
+};
+
+// Sorted word list front coded in blocks. Each block starts with an
+// uncompressed head [len][bytes]; the following words are stored as
+// [shared prefix with previous word][suffix len][suffix bytes]. Lookup
+// binary searches the heads and then walks one block comparing only
+// suffixes, so words are never materialized. Words added after load go
+// to a small sorted overflow set.
+class SpellChecker_FrontCoded final
+{
+public:
+	explicit SpellChecker_FrontCoded(size_t block_size = 32) : block_size(std::max<size_t>(block_size, 1)) {}
+	// words loaded before are kept, the coded list is rebuilt with them
+	void load(const std::string &dictionary) {
+		std::vector<std::string> words = spell_checker_detail::read_words(dictionary);
+		std::vector<std::string> loaded = decode();
+		words.insert(words.end(), loaded.begin(), loaded.end());
+		words.insert(words.end(), added.begin(), added.end());
+		added.clear();
+		if (!std::is_sorted(words.begin(), words.end()))
+			std::sort(words.begin(), words.end());
+		words.erase(std::unique(words.begin(), words.end()), words.end());
+		build(words);
+	}
+	void load_parallel(const std::string &dictionary, unsigned threads) { load(dictionary); }
+	bool check(const std::string &word) const {
+		char query[MAX_CODED + PAD];
+		if (word.size() > MAX_CODED)
+			return false;
+		size_t n = word.size();
+		std::transform(word.begin(), word.end(), query, ::tolower);
+		std::fill(query + n, query + n + PAD, 0);
+		if (find(reinterpret_cast<const unsigned char *>(query), n))
+			return true;
+		return !added.empty() && added.count(std::string(query, n));
+	}
+	void add(const std::string &word) {
+		if (word.empty() || word.size() > MAX_CODED || check(word))
+			return;
+		std::string wordLower(word);
+		std::transform(word.begin(), word.end(), wordLower.begin(), ::tolower);
+		added.insert(wordLower);
+	}
+	size_t size(void) const { return coded + added.size(); }
+	bool set_weight(const std::string &word, unsigned weight) { return false; }
+	// merges the coded words following the prefix with the overflow set
+	void complete(const std::string &prefix, CompletionSink &sink) const {
+		char buf[MAX_CODED];
+		size_t n = prefix.size();
+		if (n > MAX_CODED)
+			return; // no coded word is that long
+		std::transform(prefix.begin(), prefix.end(), buf, ::tolower);
+		std::string low(buf, n);
+		auto extra = added.lower_bound(low);
+		auto extra_ok = [&]() {
+			return extra != added.end() && !extra->compare(0, n, low);
+		};
+
+		size_t block = upper_head(reinterpret_cast<const unsigned char *>(low.data()), n);
+		block = block ? block - 1 : 0;
+		const unsigned char *p = offsets.empty() ? nullptr : &data[offsets[block]];
+		const unsigned char *end = data.data() + coded_bytes;
+		size_t len = 0;
+		while (p && p < end) {
+			if (p == &data[offsets[block]]) {
+				len = *p++;
+				std::copy(p, p + len, buf);
+				p += len;
+				if (++block == offsets.size())
+					block = offsets.size() - 1;
+			}
+			else {
+				std::copy(p + 2, p + 2 + p[1], buf + p[0]);
+				len = p[0] + p[1];
+				p += 2 + p[1];
+			}
+			int cmp = std::string::traits_type::compare(buf, low.data(), std::min(len, n));
+			if (cmp < 0 || (!cmp && len < n))
+				continue;
+			if (cmp > 0)
+				break;
+			for (; extra_ok() && extra->compare(0, std::string::npos, buf, len) < 0; ++extra)
+				if (!sink.wants(0) || !sink.push(extra->data(), extra->size(), 0))
+					return;
+			if (!sink.wants(0) || !sink.push(buf, len, 0))
+				return;
+		}
+		for (; extra_ok(); ++extra)
+			if (!sink.wants(0) || !sink.push(extra->data(), extra->size(), 0))
+				return;
+	}
+	SpellChecker_Stats stats(void) const {
+		SpellChecker_Stats res;
+		res.bytes = coded_bytes + offsets.size() * sizeof(uint32_t);
+		for (const std::string &word : added)
+			res.bytes += sizeof(std::string) + word.capacity();
+		return res;
+	}
+private:
+	enum : size_t {
+		MAX_CODED = 255,
+		PAD = 16 // lets mismatch() read whole vectors past the end
+	};
+	// index of first differing byte of a and b within n bytes
+	static size_t mismatch(const unsigned char *a, const unsigned char *b, size_t n) {
+		size_t i = 0;
+#ifdef __SSE2__
+		for (; i < n; i += 16) {
+			__m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)),
+				_mm_loadu_si128((const __m128i *)(b + i)));
+			unsigned mask = ~_mm_movemask_epi8(eq) & 0xffff;
+			if (mask)
+				return std::min(n, i + __builtin_ctz(mask));
+		}
+		return n;
+#else
+		while (i < n && a[i] == b[i])
+			++i;
+		return i;
+#endif
+	}
+	// number of blocks whose head is <= query
+	size_t upper_head(const unsigned char *query, size_t n) const {
+		size_t lo = 0, hi = offsets.size();
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			const unsigned char *head = &data[offsets[mid]];
+			size_t len = head[0];
+			int cmp = memcmp(head + 1, query, std::min(len, n));
+			if (cmp < 0 || (!cmp && len <= n))
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo;
+	}
+	// query must be padded with PAD bytes
+	bool find(const unsigned char *query, size_t n) const {
+		size_t block = upper_head(query, n);
+		if (!block)
+			return false;
+		const unsigned char *p = &data[offsets[block - 1]];
+		const unsigned char *end = block < offsets.size() ? &data[offsets[block]] : data.data() + coded_bytes;
+		size_t len = *p++;
+		// m - common prefix of query and previous word, which is smaller than query
+		size_t m = mismatch(p, query, std::min(len, n));
+		if (m == len && m == n)
+			return true;
+		for (p += len; p < end;) {
+			size_t lcp = p[0], suffix = p[1];
+			const unsigned char *s = p + 2;
+			p = s + suffix;
+			if (lcp > m)
+				continue; // still agrees with previous word beyond query, so smaller
+			if (lcp < m)
+				return false; // grew at a position query shares with previous word
+			size_t k = mismatch(s, query + m, std::min(suffix, n - m));
+			if (k == suffix && m + k == n)
+				return true;
+			if (m + k == n || (k < suffix && s[k] > query[m + k]))
+				return false;
+			m += k;
+		}
+		return false;
+	}
+	// all coded words in order
+	std::vector<std::string> decode() const {
+		std::vector<std::string> words;
+		words.reserve(coded);
+		std::string word;
+		for (size_t block = 0; block < offsets.size(); ++block) {
+			const unsigned char *p = &data[offsets[block]];
+			const unsigned char *end = block + 1 < offsets.size() ? &data[offsets[block + 1]] : data.data() + coded_bytes;
+			word.assign(p + 1, p + 1 + *p);
+			words.push_back(word);
+			for (p += 1 + *p; p < end; p += 2 + p[1]) {
+				word.resize(p[0]);
+				word.append(p + 2, p + 2 + p[1]);
+				words.push_back(word);
+			}
+		}
+		return words;
+	}
+	void build(const std::vector<std::string> &words) {
+		data.clear();
+		offsets.clear();
+		coded = 0;
+		const std::string *prev = nullptr;
+		for (const std::string &word : words) {
+			if (word.empty() || word.size() > MAX_CODED)
+				continue; // no valid word is that long
+			if (coded % block_size == 0) {
+				offsets.push_back((uint32_t)data.size());
+				data.push_back((unsigned char)word.size());
+				data.insert(data.end(), word.begin(), word.end());
+			}
+			else {
+				size_t lcp = std::mismatch(prev->begin(), prev->begin() + std::min(prev->size(), word.size()),
+					word.begin()).first - prev->begin();
+				data.push_back((unsigned char)lcp);
+				data.push_back((unsigned char)(word.size() - lcp));
+				data.insert(data.end(), word.begin() + lcp, word.end());
+			}
+			prev = &word;
+			++coded;
+		}
+		coded_bytes = data.size();
+		data.resize(coded_bytes + PAD, 0);
+		data.shrink_to_fit();
+		offsets.shrink_to_fit();
+	}
+	size_t block_size;
+	std::vector<unsigned char> data;
+	std::vector<uint32_t> offsets;
+	size_t coded_bytes = 0;
+	size_t coded = 0;
+	std::set<std::string> added;
+};
@@ -0,0 +1,200 @@
+#include "spell_checker_journal.h"
+#include <algorithm>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const char JOURNAL_MAGIC[4] = { 'S', 'C', 'J', '1' };
+static const size_t FRAME_HEADER = 2 * sizeof(uint32_t);
+
+// FNV-1a, enough to tell a torn frame from a complete one
+static uint32_t checksum(const char *data, size_t size) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; ++i)
+		hash = (hash ^ (unsigned char)data[i]) * 16777619u;
+	return hash;
+}
+
+static void put_varint(std::string &out, size_t value) {
+	while (value >= 0x80) {
+		out.push_back(char(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(char(value));
+}
+
+static bool get_varint(const char *&pos, const char *end, size_t &value) {
+	value = 0;
+	for (int shift = 0; pos != end && shift < 64; shift += 7) {
+		unsigned char c = *pos++;
+		value |= size_t(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return true;
+	}
+	return false;
+}
+
+static void sync_path(const std::string &path, int flags) {
+	int fd = open(path.c_str(), flags);
+	if (fd < 0)
+		throw SpellChecker_JournalError();
+	int res = fsync(fd);
+	close(fd);
+	if (res)
+		throw SpellChecker_JournalError();
+}
+
+SpellChecker_Journal::SpellChecker_Journal(const std::string &journal, const std::string &dictionary,
+	size_t group_size, size_t compact_after)
+	: path_(journal), dictionary_(dictionary), group_size_(std::max<size_t>(group_size, 1)),
+	compact_after_(compact_after), compact_at_(compact_after) {
+	fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (fd_ < 0)
+		throw SpellChecker_JournalError();
+	struct stat st;
+	bool ok = !fstat(fd_, &st);
+	if (ok && !st.st_size)
+		ok = write(fd_, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) == sizeof(JOURNAL_MAGIC) && !fdatasync(fd_);
+	if (!ok) {
+		close(fd_);
+		throw SpellChecker_JournalError();
+	}
+}
+
+SpellChecker_Journal::~SpellChecker_Journal() {
+	try {
+		sync();
+	}
+	catch (const SpellChecker_JournalError &) {
+	}
+	close(fd_);
+}
+
+std::vector<std::string> SpellChecker_Journal::replay() {
+	struct stat st;
+	if (fstat(fd_, &st))
+		throw SpellChecker_JournalError();
+	std::string data(st.st_size, '\0');
+	if (pread(fd_, &data[0], data.size(), 0) != (ssize_t)data.size())
+		throw SpellChecker_JournalError();
+	if (data.size() < sizeof(JOURNAL_MAGIC) || memcmp(data.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)))
+		throw SpellChecker_JournalError();
+
+	std::vector<std::string> res;
+	size_t good = sizeof(JOURNAL_MAGIC);
+	while (data.size() - good >= FRAME_HEADER) {
+		uint32_t size, sum;
+		memcpy(&size, data.data() + good, sizeof(size));
+		memcpy(&sum, data.data() + good + sizeof(size), sizeof(sum));
+		const char *pos = data.data() + good + FRAME_HEADER;
+		if (size > data.size() - good - FRAME_HEADER || checksum(pos, size) != sum)
+			break;
+		const char *end = pos + size;
+		size_t len;
+		while (pos != end && get_varint(pos, end, len) && len <= size_t(end - pos)) {
+			res.emplace_back(pos, len);
+			pos += len;
+		}
+		good += FRAME_HEADER + size;
+	}
+	// drop a frame torn by crash so that new groups follow a valid one
+	if (good != data.size() && (ftruncate(fd_, good) || fdatasync(fd_)))
+		throw SpellChecker_JournalError();
+	words_ = res.size() + pending_words_;
+	return res;
+}
+
+void SpellChecker_Journal::append(const std::string &word) {
+	put_varint(pending_, word.size());
+	pending_ += word;
+	++pending_words_;
+	++words_;
+	if (pending_words_ >= group_size_)
+		sync();
+	// the word is already journaled, so a failed merge is only retried
+	// after another compact_after words instead of failing every add
+	if (compact_after_ && words_ > compact_at_) {
+		sync();
+		try {
+			compact();
+		}
+		catch (const SpellChecker_JournalError &) {
+			compact_at_ = words_ + compact_after_;
+		}
+	}
+}
+
+void SpellChecker_Journal::sync() {
+	if (!pending_words_)
+		return;
+	uint32_t header[2] = { (uint32_t)pending_.size(), checksum(pending_.data(), pending_.size()) };
+	std::string frame(reinterpret_cast<const char *>(header), FRAME_HEADER);
+	frame += pending_;
+	write_all(frame.data(), frame.size());
+	if (fdatasync(fd_))
+		throw SpellChecker_JournalError();
+	pending_.clear();
+	pending_words_ = 0;
+}
+
+void SpellChecker_Journal::compact() {
+	sync();
+	std::vector<std::string> added = replay();
+	std::sort(added.begin(), added.end());
+	added.erase(std::unique(added.begin(), added.end()), added.end());
+
+	// merge sorted journal words into sorted dictionary, written aside
+	std::string tmp = dictionary_ + ".tmp";
+	std::ifstream base(dictionary_);
+	if (!base.is_open())
+		throw SpellChecker_JournalError();
+	try {
+		{
+			std::ofstream out(tmp);
+			std::string word;
+			bool more = static_cast<bool>(base >> word);
+			auto next = added.begin();
+			while (more || next != added.end()) {
+				if (!more || (next != added.end() && *next < word)) {
+					out << *next++ << '\n';
+					continue;
+				}
+				if (next != added.end() && *next == word)
+					++next;
+				out << word << '\n';
+				more = static_cast<bool>(base >> word);
+			}
+			// a read error ends the loop like eof, keep dictionary untouched then
+			if (base.bad() || !out.flush())
+				throw SpellChecker_JournalError();
+		}
+		sync_path(tmp, O_RDONLY);
+		if (rename(tmp.c_str(), dictionary_.c_str()))
+			throw SpellChecker_JournalError();
+	}
+	catch (const SpellChecker_JournalError &) {
+		std::remove(tmp.c_str());
+		throw;
+	}
+	size_t slash = dictionary_.rfind('/');
+	sync_path(slash == std::string::npos ? "." : dictionary_.substr(0, slash + 1), O_RDONLY | O_DIRECTORY);
+
+	if (ftruncate(fd_, sizeof(JOURNAL_MAGIC)) || fdatasync(fd_))
+		throw SpellChecker_JournalError();
+	words_ = 0;
+	compact_at_ = compact_after_;
+}
+
+void SpellChecker_Journal::write_all(const char *data, size_t size) {
+	while (size) {
+		ssize_t n = write(fd_, data, size);
+		if (n < 0)
+			throw SpellChecker_JournalError();
+		data += n;
+		size -= n;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// exception on failure to open, write or compact journal file
+class SpellChecker_JournalError
+{
+};
+
+// Append-only binary log of words added to a dictionary.
+//
+// Words are buffered and written in groups: every group is one frame
+// [payload length][checksum][payload] followed by a single fdatasync, so
+// high add rates pay for one sync per group_size words. Payload is a list
+// of varint length prefixed words. A frame torn by a crash fails its
+// checksum on replay and is cut off together with everything after it.
+//
+// When the journal holds more than compact_after words they are merged
+// into the sorted dictionary file (written aside and renamed over it) and
+// the journal is emptied. A failed automatic merge does not fail append();
+// it is retried once another compact_after words have been added.
+class SpellChecker_Journal
+{
+  public:
+    SpellChecker_Journal(const std::string &journal, const std::string &dictionary,
+                         size_t group_size, size_t compact_after);
+    ~SpellChecker_Journal();
+
+    // words stored in journal, in order they were added
+    std::vector<std::string> replay();
+
+    // buffers word, commits group once group_size words are pending
+    void append(const std::string &word);
+
+    // writes and syncs pending words
+    void sync();
+
+    // merges journal into dictionary file and truncates journal
+    void compact();
+
+    // number of words in journal, including pending ones
+    size_t words(void) const { return words_; }
+
+  private:
+    void write_all(const char *data, size_t size);
+
+    std::string path_;
+    std::string dictionary_;
+    size_t group_size_;
+    size_t compact_after_;
+    size_t compact_at_; // words_ above which append() compacts
+    int fd_ = -1;
+    std::string pending_;
+    size_t pending_words_ = 0;
+    size_t words_ = 0;
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+// Hardware performance counters read through Linux perf_event_open.
+// Every event is opened on its own, so counters refused by the kernel or
+// missing on the machine (VMs, perf_event_paranoid) are just reported as
+// unavailable while the others keep working.
+
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+class PerfCounters
+{
+  public:
+    enum Event
+    {
+        Cycles,
+        Instructions,
+        L1DMisses,
+        LLCMisses,
+        DTLBMisses,
+        BranchMisses,
+        TaskClock,  // software, nanoseconds on cpu
+        PageFaults, // software
+        EventCount
+    };
+
+    PerfCounters()
+    {
+        for (int i = 0; i < EventCount; ++i)
+        {
+            fd_[i] = open_event(Event(i));
+            value_[i] = 0;
+        }
+    }
+
+    ~PerfCounters()
+    {
+        for (int fd : fd_)
+            if (fd >= 0)
+                close(fd);
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    void start()
+    {
+#ifdef __linux__
+        for (int fd : fd_)
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+    }
+
+    void stop()
+    {
+#ifdef __linux__
+        for (int i = 0; i < EventCount; ++i)
+        {
+            if (fd_[i] < 0)
+                continue;
+            ioctl(fd_[i], PERF_EVENT_IOC_DISABLE, 0);
+            // value scaled up when the kernel multiplexed the counter
+            uint64_t data[3];
+            if (read(fd_[i], data, sizeof(data)) != sizeof(data) || !data[2])
+                value_[i] = 0;
+            else
+                value_[i] = (double)data[0] * data[1] / data[2];
+        }
+#endif
+    }
+
+    bool available(Event event) const { return fd_[event] >= 0; }
+
+    bool any_hardware() const
+    {
+        for (int i = Cycles; i <= BranchMisses; ++i)
+            if (fd_[i] >= 0)
+                return true;
+        return false;
+    }
+
+    double value(Event event) const { return value_[event]; }
+
+    static const char *name(Event event)
+    {
+        static const char *names[EventCount] = {"cycles", "instr", "L1d-miss", "LLC-miss",
+                                                "dTLB-miss", "br-miss", "task-ns", "faults"};
+        return names[event];
+    }
+
+  private:
+    static int open_event(Event event)
+    {
+#ifdef __linux__
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        auto cache = [](uint64_t cache, uint64_t op) {
+            return cache | (op << 8) | ((uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        switch (event)
+        {
+        case Cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case Instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case L1DMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ);
+            break;
+        case LLCMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case DTLBMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ);
+            break;
+        case BranchMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case TaskClock:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_TASK_CLOCK;
+            break;
+        case PageFaults:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+            break;
+        default:
+            return -1;
+        }
+        return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+        return -1;
+#endif
+    }
+
+    int fd_[EventCount];
+    double value_[EventCount];
+};
@@ -3,12 +3,21 @@
 //
 
 #include "spell_checker.h"
+#include "basic_spell_checker.h"
+#include "spell_checker_journal.h"
+#include "perf_counters.h"
 #include "gtest/gtest.h"
 #include <fstream>
 #include <list>
 #include <chrono>
 #include <unordered_set>
 #include <iomanip>
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
 
 const char *large_dict_file = "../dictionaries/large";
 const unsigned large_dict_words_count = 143091;
@@ -125,6 +134,79 @@ TEST(SpellChecker, load_Trie)
     test_load(ContainerType::Trie);
 }
 
+TEST(SpellChecker, load_AdaptiveRadixTree)
+{
+    test_load(ContainerType::AdaptiveRadixTree);
+}
+
+TEST(SpellChecker, load_FrontCoded)
+{
+    test_load(ContainerType::FrontCoded);
+}
+
+// second load adds to the words of the first one
+void test_load_twice(ContainerType type)
+{
+    const char *first = "first_dict.tmp", *second = "second_dict.tmp";
+    std::ofstream(first) << "apple\nzebra\n";
+    std::ofstream(second) << "cherry\n";
+    SpellChecker obj(type);
+    obj.load(first);
+    obj.add("kiwi");
+    obj.load(second);
+    std::remove(first);
+    std::remove(second);
+    EXPECT_EQ(obj.size(), 4);
+    for (auto i : {"apple", "zebra", "cherry", "kiwi"})
+    {
+        EXPECT_EQ(obj.check(i), true) << i;
+    }
+}
+
+TEST(SpellChecker, load_twice_Set)
+{
+    test_load_twice(ContainerType::Set);
+}
+
+TEST(SpellChecker, load_twice_FrontCoded)
+{
+    test_load_twice(ContainerType::FrontCoded);
+}
+
+void test_load_parallel(ContainerType type)
+{
+    for (unsigned threads : {1u, 2u, 4u, 32u})
+    {
+        SpellChecker obj(type);
+        obj.load_parallel(large_dict_file, threads);
+        EXPECT_EQ(obj.size(), large_dict_words_count);
+
+        for (auto i : list_valid)
+        {
+            EXPECT_EQ(obj.check(i), true);
+        }
+        for (auto i : list_misspelled)
+        {
+            EXPECT_EQ(obj.check(i), false);
+        }
+    }
+}
+
+TEST(SpellChecker, load_parallel_Set)
+{
+    test_load_parallel(ContainerType::Set);
+}
+
+TEST(SpellChecker, load_parallel_CustomHashTable)
+{
+    test_load_parallel(ContainerType::CustomHashTable);
+}
+
+TEST(SpellChecker, load_parallel_Trie)
+{
+    test_load_parallel(ContainerType::Trie);
+}
+
 TEST(SpellChecker, invalid_dict_throws_exc)
 {
     SpellChecker obj(ContainerType::Vector);
@@ -148,9 +230,9 @@ void test_valid_and_misspelled(ContainerType type)
     }
 }
 
-void test_add_and_check(ContainerType type)
+void test_add_and_check(ContainerType type, MemoryPlacement placement = MemoryPlacement::Heap)
 {
-    SpellChecker obj(type);
+    SpellChecker obj(type, placement);
     EXPECT_EQ(obj.size(), 0);
     obj.load(large_dict_file);
     size_t dictSize = obj.size();
@@ -200,6 +282,111 @@ TEST(SpellChecker, test_add_and_check_Trie)
     test_add_and_check(ContainerType::Trie);
 }
 
+TEST(SpellChecker, test_add_and_check_AdaptiveRadixTree)
+{
+    test_add_and_check(ContainerType::AdaptiveRadixTree);
+}
+
+TEST(SpellChecker, add_non_word_chars_AdaptiveRadixTree)
+{
+    SpellChecker obj(ContainerType::AdaptiveRadixTree);
+    obj.load(large_dict_file);
+    for (auto i : {"s_", "café", "c0", "co-"})
+    {
+        obj.add(i);
+        EXPECT_EQ(obj.size(), large_dict_words_count) << i;
+    }
+}
+
+TEST(SpellChecker, test_add_and_check_FrontCoded)
+{
+    test_add_and_check(ContainerType::FrontCoded);
+}
+
+TEST(SpellChecker, test_add_and_check_Trie_HugePages)
+{
+    test_add_and_check(ContainerType::Trie, MemoryPlacement::HugePages);
+}
+
+// falls back to HugePages on single node hosts, see numa_replicas_with_fake_topology
+TEST(SpellChecker, test_add_and_check_Trie_NumaReplicated)
+{
+    test_add_and_check(ContainerType::Trie, MemoryPlacement::NumaReplicated);
+}
+
+// two node topology read from a fake sysfs tree, so that replication runs
+// on single node hosts too
+TEST(SpellChecker, numa_replicas_with_fake_topology)
+{
+    const std::string sysfs = "fake_numa.tmp";
+    const char *cpulists[] = {"0,2-3\n", "1,4-5\n"};
+    mkdir(sysfs.c_str(), 0755);
+    for (int node = 0; node < 2; ++node)
+    {
+        std::string dir = sysfs + "/node" + std::to_string(node);
+        mkdir(dir.c_str(), 0755);
+        std::ofstream(dir + "/cpulist") << cpulists[node];
+    }
+    NumaTopology numa(sysfs);
+    for (int node = 0; node < 2; ++node)
+    {
+        std::string dir = sysfs + "/node" + std::to_string(node);
+        std::remove((dir + "/cpulist").c_str());
+        rmdir(dir.c_str());
+    }
+    rmdir(sysfs.c_str());
+
+    ASSERT_EQ(numa.nodes(), 2);
+    EXPECT_EQ(numa.cpus(0), (std::vector<int>{0, 2, 3}));
+    EXPECT_EQ(numa.cpus(1), (std::vector<int>{1, 4, 5}));
+
+    numa.pin_current(0);
+    BasicSpellChecker<SpellChecker_Trie> obj(MemoryPlacement::NumaReplicated, &numa);
+    obj.load(large_dict_file);
+    obj.add("google");
+    EXPECT_EQ(obj.set_weight("absorb", 7), true);
+    // journal replay sized burst, every add also updates the replica
+    std::vector<std::string> burst;
+    for (int i = 0; i < 5000; ++i)
+        burst.push_back(std::string("qx") + char('a' + i % 26) + char('a' + i / 26 % 26) + char('a' + i / 676));
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto &word : burst)
+        obj.add(word);
+    double time = (std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "replicated add: " << (int)(time / burst.size()) << " ns per word" << std::endl;
+
+    for (int node : {1, 0})
+    {
+        numa.pin_current(node);
+        EXPECT_EQ(obj.size(), large_dict_words_count + 1 + burst.size());
+        EXPECT_EQ(obj.check(burst.front()), true) << "node " << node;
+        EXPECT_EQ(obj.check(burst.back()), true) << "node " << node;
+        for (auto i : list_valid)
+        {
+            EXPECT_EQ(obj.check(i), true) << "node " << node;
+        }
+        for (auto i : list_misspelled)
+        {
+            EXPECT_EQ(obj.check(i), false) << "node " << node;
+        }
+        EXPECT_EQ(obj.check("google"), true) << "node " << node;
+        std::vector<SpellChecker_Completion> out;
+        ASSERT_EQ(obj.complete("abso", 1, out, CompletionOrder::Weight), 1);
+        EXPECT_EQ(out[0].word, "absorb") << "node " << node;
+    }
+}
+
+TEST(SpellChecker, load_parallel_Trie_HugePages)
+{
+    SpellChecker obj(ContainerType::Trie, MemoryPlacement::HugePages);
+    obj.load_parallel(large_dict_file, 4);
+    EXPECT_EQ(obj.size(), large_dict_words_count);
+    for (auto i : list_valid)
+    {
+        EXPECT_EQ(obj.check(i), true);
+    }
+}
+
 TEST(SpellChecker, when_valid_word_is_valid_returns_true)
 {
     for (auto i : list_valid)
@@ -286,6 +473,8 @@ double get_reference_time() {
         i++;
         std::ifstream infile;
         infile.open(test.text);
+        if (infile.fail())
+            continue; // speed test text not shipped with this checkout
         std::string line;
         std::list<std::string> words;
         
@@ -329,8 +518,8 @@ double get_reference_time() {
     return timeSpent;
 }
 
-double measure_performance(ContainerType type) {
-    SpellChecker obj(type);
+double measure_performance(ContainerType type, MemoryPlacement placement = MemoryPlacement::Heap) {
+    SpellChecker obj(type, placement);
     obj.load(large_dict_file);
 
     double timeSpent = 0;
@@ -338,6 +527,8 @@ double measure_performance(ContainerType type) {
     for (auto test : speedTestData) {
         std::ifstream infile;
         infile.open(test.text);
+        if (infile.fail())
+            continue; // speed test text not shipped with this checkout
         std::string line;
         std::list<std::string> words;
         
@@ -413,6 +604,90 @@ void test_performance(ContainerType type)
     }
 }
 
+std::vector<std::string> read_tokens(const char *text)
+{
+    std::ifstream infile(text);
+    std::vector<std::string> tokens;
+    std::string line;
+    while (infile >> line)
+        tokens.push_back(line);
+    return tokens;
+}
+
+// tokens of text that are words to check, the rest is skipped
+std::vector<std::string> read_valid_tokens(const char *text)
+{
+    auto tokens = read_tokens(text);
+    tokens.erase(std::remove_if(tokens.begin(), tokens.end(),
+                                [](const std::string &token) { return !SpellChecker::is_valid(token); }),
+                 tokens.end());
+    return tokens;
+}
+
+void test_check_document(ContainerType type)
+{
+    SpellChecker obj(type);
+    obj.load(large_dict_file);
+
+    for (auto test : data)
+    {
+        auto tokens = read_tokens(test.text);
+        auto direct = obj.check_document(tokens, false);
+        auto dedup = obj.check_document(tokens, true);
+        EXPECT_EQ(direct.total, test.total);
+        EXPECT_EQ(direct.valid, test.valid);
+        EXPECT_EQ(direct.misspelled, test.missed);
+        EXPECT_EQ(dedup.total, test.total);
+        EXPECT_EQ(dedup.valid, test.valid);
+        EXPECT_EQ(dedup.misspelled, test.missed);
+        EXPECT_EQ(dedup.offsets, direct.offsets);
+    }
+}
+
+TEST(SpellChecker, check_document_set)
+{
+    test_check_document(ContainerType::Set);
+}
+
+TEST(SpellChecker, check_document_trie)
+{
+    test_check_document(ContainerType::Trie);
+}
+
+// dedup pays one hash-map probe per token, so it wins only when
+// dictionary lookup is more expensive than interning
+void report_document_speed(ContainerType type, const char *name)
+{
+    SpellChecker obj(type);
+    obj.load(large_dict_file);
+
+    for (auto test : {data[0], data[1], speedTestData[1]})
+    {
+        auto tokens = read_tokens(test.text);
+        if (tokens.empty())
+            continue;
+        double time[2] = {0, 0};
+        for (bool dedup : {false, true})
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            auto report = obj.check_document(tokens, dedup);
+            time[dedup] = (std::chrono::high_resolution_clock::now() - start).count();
+            EXPECT_EQ(report.misspelled, test.missed);
+        }
+        std::cout << name << " " << test.text << ": direct " << (int)(time[0] / 1000000)
+                  << " ms, dedup " << (int)(time[1] / 1000000) << " ms" << std::endl;
+    }
+}
+
+TEST(SpellChecker, check_document_dedup_speed)
+{
+    report_document_speed(ContainerType::Vector, "Vector");
+    report_document_speed(ContainerType::Set, "Set");
+    report_document_speed(ContainerType::Unordered_Set, "Unordered_Set");
+    report_document_speed(ContainerType::CustomHashTable, "CustomHashTable");
+    report_document_speed(ContainerType::Trie, "Trie");
+}
+
 TEST(SpellChecker, performance_check_vector)
 {
     test_performance(ContainerType::Vector);
@@ -436,6 +711,659 @@ TEST(SpellChecker, performance_check_trie)
     test_performance(ContainerType::Trie);
 }
 
+// large dictionary enlarged with apostrophe suffixed copies of every word
+const char *enlarged_dict_file = "large_x4.tmp";
+
+void write_enlarged_dict()
+{
+    std::ifstream infile(large_dict_file);
+    std::set<std::string> words;
+    std::string line;
+    while (infile >> line)
+    {
+        words.insert(line);
+        for (auto suffix : {"'a", "'b", "'c"})
+            words.insert(line + suffix);
+    }
+    std::ofstream outfile(enlarged_dict_file);
+    for (auto &word : words)
+        outfile << word << '\n';
+}
+
+void report_load_scaling(ContainerType type, const char *name, const char *dict)
+{
+    unsigned max_threads = std::max(4u, std::thread::hardware_concurrency());
+    double serial = 0;
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+    {
+        SpellChecker obj(type);
+        auto start = std::chrono::high_resolution_clock::now();
+        obj.load_parallel(dict, threads);
+        double time = (std::chrono::high_resolution_clock::now() - start).count();
+        if (threads == 1)
+            serial = time;
+        std::cout << name << " " << dict << " threads " << threads << ": "
+                  << (int)(time / 1000000) << " ms, speedup " << std::setprecision(2)
+                  << serial / time << std::endl;
+    }
+}
+
+TEST(SpellChecker, load_parallel_scaling)
+{
+    write_enlarged_dict();
+    for (auto dict : {large_dict_file, enlarged_dict_file})
+    {
+        report_load_scaling(ContainerType::CustomHashTable, "CustomHashTable", dict);
+        report_load_scaling(ContainerType::Trie, "Trie", dict);
+    }
+    std::remove(enlarged_dict_file);
+}
+
+TEST(SpellChecker, placement_speed)
+{
+    auto heap = measure_performance(ContainerType::Trie);
+    auto huge = measure_performance(ContainerType::Trie, MemoryPlacement::HugePages);
+    auto numa = measure_performance(ContainerType::Trie, MemoryPlacement::NumaReplicated);
+    std::cout << "Trie heap " << (int)(heap/referenceTime * 100) << "%, huge pages "
+              << (int)(huge/referenceTime * 100) << "%, NUMA replicated "
+              << (int)(numa/referenceTime * 100) << "% of reference time" << std::endl;
+}
+
+TEST(SpellChecker, performance_check_adaptive_radix_tree)
+{
+    test_performance(ContainerType::AdaptiveRadixTree);
+}
+
+TEST(SpellChecker, performance_check_front_coded)
+{
+    test_performance(ContainerType::FrontCoded);
+}
+
+void report_footprint(ContainerType type, const char *name)
+{
+    SpellChecker obj(type);
+    obj.load(large_dict_file);
+    auto stats = obj.stats();
+    auto tokens = read_valid_tokens(speedTestData[1].text);
+    unsigned misspelled = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto &token : tokens)
+        misspelled += !obj.check(token);
+    double time = (std::chrono::high_resolution_clock::now() - start).count();
+    EXPECT_EQ(misspelled, speedTestData[1].missed);
+    std::cout << name << ": " << stats.nodes << " nodes, " << stats.bytes / 1024 << " KB, "
+              << std::setprecision(3) << time / tokens.size() << " ns per lookup" << std::endl;
+}
+
+TEST(SpellChecker, adaptive_radix_tree_footprint)
+{
+    report_footprint(ContainerType::Trie, "Trie");
+    report_footprint(ContainerType::AdaptiveRadixTree, "AdaptiveRadixTree");
+    EXPECT_LT(measure_performance(ContainerType::AdaptiveRadixTree), referenceTime);
+}
+
+const char *completion_prefixes[] = {"a", "co", "pre", "th", "un", "z", "abso", "won"};
+
+std::vector<std::string> expected_completions(const std::string &prefix, size_t k)
+{
+    std::vector<std::string> res;
+    std::ifstream infile(large_dict_file);
+    std::string line;
+    while (res.size() < k && infile >> line)
+        if (line.compare(0, prefix.size(), prefix) == 0)
+            res.push_back(line);
+    return res;
+}
+
+void test_complete(ContainerType type)
+{
+    SpellChecker obj(type);
+    obj.load(large_dict_file);
+    std::vector<SpellChecker_Completion> out;
+
+    for (auto prefix : completion_prefixes)
+    {
+        auto expected = expected_completions(prefix, 10);
+        size_t n = obj.complete(prefix, 10, out);
+        ASSERT_EQ(n, expected.size());
+        for (size_t i = 0; i < n; ++i)
+        {
+            EXPECT_EQ(out[i].word, expected[i]);
+        }
+    }
+    EXPECT_EQ(obj.complete("Abso", 3, out), 3);
+    EXPECT_EQ(out[0].word, "absolute");
+    EXPECT_EQ(obj.complete("qqq", 10, out), 0);
+    for (auto prefix : {"a_", "café", "c0", "co-"})
+    {
+        EXPECT_EQ(obj.complete(prefix, 10, out), 0) << prefix;
+    }
+    EXPECT_EQ(obj.complete("abso", 0, out), 0);
+    // prefix longer than any completion is not cut down to a shorter one
+    obj.add(std::string(70, 'a'));
+    EXPECT_EQ(obj.complete(std::string(64, 'a') + "zzz", 10, out), 0);
+    EXPECT_EQ(obj.complete(std::string(300, 'a'), 10, out), 0);
+}
+
+TEST(SpellChecker, complete_Set)
+{
+    test_complete(ContainerType::Set);
+}
+
+TEST(SpellChecker, complete_Trie)
+{
+    test_complete(ContainerType::Trie);
+}
+
+TEST(SpellChecker, complete_AdaptiveRadixTree)
+{
+    test_complete(ContainerType::AdaptiveRadixTree);
+}
+
+void test_complete_by_weight(ContainerType type)
+{
+    SpellChecker obj(type);
+    obj.load(large_dict_file);
+    EXPECT_EQ(obj.set_weight("absolutely", 50), true);
+    EXPECT_EQ(obj.set_weight("absorb", 70), true);
+    EXPECT_EQ(obj.set_weight("absolve", 50), true);
+    EXPECT_EQ(obj.set_weight("absorbx", 10), false);
+    EXPECT_EQ(obj.set_weight("a_", 3), false);
+    EXPECT_EQ(obj.set_weight("co-", 9), false); // '-' shares its symbol with 'm'
+
+    std::vector<SpellChecker_Completion> out;
+    ASSERT_EQ(obj.complete("abso", 4, out, CompletionOrder::Weight), 4);
+    EXPECT_EQ(out[0].word, "absorb");
+    EXPECT_EQ(out[0].weight, 70);
+    EXPECT_EQ(out[1].word, "absolutely");
+    EXPECT_EQ(out[2].word, "absolve");
+    EXPECT_EQ(out[3].weight, 0);
+    EXPECT_EQ(out[3].word, expected_completions("abso", 1)[0]);
+    ASSERT_EQ(obj.complete("com", 1, out, CompletionOrder::Weight), 1);
+    EXPECT_EQ(out[0].weight, 0);
+}
+
+TEST(SpellChecker, complete_FrontCoded)
+{
+    test_complete(ContainerType::FrontCoded);
+}
+
+TEST(SpellChecker, complete_by_weight_Trie)
+{
+    test_complete_by_weight(ContainerType::Trie);
+}
+
+TEST(SpellChecker, complete_by_weight_AdaptiveRadixTree)
+{
+    test_complete_by_weight(ContainerType::AdaptiveRadixTree);
+}
+
+void report_complete_speed(ContainerType type, const char *name)
+{
+    SpellChecker obj(type);
+    obj.load(large_dict_file);
+    // word frequencies of a text serve as completion weights
+    for (auto &token : read_valid_tokens(speedTestData[1].text))
+    {
+        std::string word(token);
+        std::transform(word.begin(), word.end(), word.begin(), ::tolower);
+        std::vector<SpellChecker_Completion> current;
+        obj.complete(word, 1, current);
+        if (!current.empty() && current[0].word == word)
+            obj.set_weight(word, current[0].weight + 1);
+    }
+
+    std::vector<SpellChecker_Completion> out;
+    const int rounds = 1000;
+    for (auto order : {CompletionOrder::Lexicographic, CompletionOrder::Weight})
+    {
+        std::cout << name << (order == CompletionOrder::Weight ? " by weight:" : " lexicographic:");
+        for (auto prefix : {"a", "co", "pre", "th", "un"})
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int k = 0; k < rounds; ++k)
+                obj.complete(prefix, 10, out, order);
+            double time = (std::chrono::high_resolution_clock::now() - start).count();
+            std::cout << " " << prefix << " " << (int)(time / rounds) << " ns";
+        }
+        std::cout << std::endl;
+    }
+}
+
+TEST(SpellChecker, complete_speed)
+{
+    report_complete_speed(ContainerType::Set, "Set");
+    report_complete_speed(ContainerType::Trie, "Trie");
+    report_complete_speed(ContainerType::AdaptiveRadixTree, "AdaptiveRadixTree");
+}
+
+const char *journal_file = "added.journal.tmp";
+const char *journal_dict_file = "journal_dict.tmp";
+const char *journal_merged_file = "journal_merged.tmp";
+
+void copy_file(const char *from, const char *to)
+{
+    std::ifstream in(from, std::ios::binary);
+    std::ofstream out(to, std::ios::binary);
+    out << in.rdbuf();
+}
+
+TEST(SpellChecker, journal_survives_restart)
+{
+    std::remove(journal_file);
+    copy_file(large_dict_file, journal_dict_file);
+    {
+        SpellChecker obj(ContainerType::Trie);
+        obj.load(journal_dict_file);
+        obj.open_journal(journal_file, journal_dict_file, 1, 0);
+        for (auto i : list2add)
+        {
+            obj.add(i);
+            obj.add(i); // duplicate is not journaled
+        }
+        obj.add("Kazka");
+    }
+    SpellChecker obj(ContainerType::Set);
+    obj.load(journal_dict_file);
+    obj.open_journal(journal_file, journal_dict_file, 1, 0);
+    EXPECT_EQ(obj.size(), large_dict_words_count + 3);
+    for (auto i : list2add)
+    {
+        EXPECT_EQ(obj.check(i), true);
+    }
+    EXPECT_EQ(obj.check("kazka"), true);
+    std::remove(journal_file);
+    std::remove(journal_dict_file);
+}
+
+TEST(SpellChecker, journal_drops_torn_group)
+{
+    std::remove(journal_file);
+    copy_file(large_dict_file, journal_dict_file);
+    {
+        SpellChecker obj(ContainerType::Trie);
+        obj.open_journal(journal_file, journal_dict_file, 2, 0);
+        obj.add("google");
+        obj.add("variadic");
+        obj.add("udemy"); // pending, written by sync on close
+    }
+    {
+        // simulate crash in the middle of writing next group: header
+        // promises 16 bytes of payload but only 7 made it to disk
+        std::ofstream out(journal_file, std::ios::binary | std::ios::app);
+        out.write("\x10\0\0\0garbage", 11);
+    }
+    {
+        SpellChecker obj(ContainerType::Trie);
+        obj.open_journal(journal_file, journal_dict_file, 2, 0);
+        EXPECT_EQ(obj.size(), 3);
+        obj.add("kazka");
+        obj.sync_journal();
+    }
+    {
+        // complete frame whose payload does not match its checksum
+        uint32_t header[2] = {7, 0};
+        std::ofstream out(journal_file, std::ios::binary | std::ios::app);
+        out.write(reinterpret_cast<const char *>(header), sizeof(header));
+        out.write("garbage", 7);
+    }
+    {
+        SpellChecker obj(ContainerType::Trie);
+        obj.open_journal(journal_file, journal_dict_file, 2, 0);
+        EXPECT_EQ(obj.size(), 4);
+        obj.add("plato");
+        obj.sync_journal();
+    }
+    SpellChecker obj(ContainerType::Trie);
+    obj.open_journal(journal_file, journal_dict_file, 2, 0);
+    EXPECT_EQ(obj.size(), 5);
+    EXPECT_EQ(obj.check("kazka"), true);
+    EXPECT_EQ(obj.check("plato"), true);
+    EXPECT_EQ(obj.check("garbage"), false);
+    std::remove(journal_file);
+    std::remove(journal_dict_file);
+}
+
+TEST(SpellChecker, journal_compacts_into_dictionary)
+{
+    std::remove(journal_file);
+    copy_file(large_dict_file, journal_dict_file);
+    {
+        SpellChecker obj(ContainerType::Trie);
+        obj.load(journal_dict_file);
+        obj.open_journal(journal_file, journal_dict_file, 4, 3);
+        for (auto i : {"zzzz", "google", "aaaa", "variadic"})
+            obj.add(i);
+    }
+    SpellChecker obj(ContainerType::Vector);
+    obj.load(journal_dict_file);
+    EXPECT_EQ(obj.size(), large_dict_words_count + 4);
+    obj.open_journal(journal_file, journal_dict_file);
+    EXPECT_EQ(obj.size(), large_dict_words_count + 4);
+
+    std::ifstream infile(journal_dict_file);
+    std::vector<std::string> words;
+    std::string line;
+    while (infile >> line)
+        words.push_back(line);
+    EXPECT_EQ(std::is_sorted(words.begin(), words.end()), true);
+    std::remove(journal_file);
+    std::remove(journal_dict_file);
+}
+
+TEST(SpellChecker, journal_failed_compact_keeps_words)
+{
+    std::remove(journal_file);
+    std::remove(journal_dict_file);
+    {
+        // automatic compaction into a missing dictionary fails on every
+        // third add but the words are journaled and add() goes on
+        SpellChecker obj(ContainerType::Trie);
+        obj.open_journal(journal_file, journal_dict_file, 1, 2);
+        for (auto i : {"google", "variadic", "udemy", "kazka", "plato"})
+        {
+            EXPECT_NO_THROW(obj.add(i)) << i;
+        }
+        EXPECT_THROW(obj.compact_journal(), SpellChecker_JournalError);
+    }
+    std::ifstream missing(journal_dict_file);
+    EXPECT_EQ(missing.is_open(), false);
+
+    // dictionary that opens but fails to read once the merged copy is started
+    mkdir(journal_dict_file, 0755);
+    {
+        SpellChecker obj(ContainerType::Trie);
+        obj.open_journal(journal_file, journal_dict_file, 1, 0);
+        EXPECT_EQ(obj.size(), 5);
+        EXPECT_EQ(obj.check("plato"), true);
+        EXPECT_THROW(obj.compact_journal(), SpellChecker_JournalError);
+    }
+    rmdir(journal_dict_file);
+    std::ifstream tmp(std::string(journal_dict_file) + ".tmp");
+    EXPECT_EQ(tmp.is_open(), false);
+    std::remove(journal_file);
+}
+
+// journal replay against the old workaround of loading a merged text file
+TEST(SpellChecker, journal_replay_speed)
+{
+    std::set<std::string> extra;
+    for (auto &token : read_valid_tokens(speedTestData[1].text))
+    {
+        std::string word(token);
+        std::transform(word.begin(), word.end(), word.begin(), ::tolower);
+        extra.insert(word + "'x");
+    }
+
+    copy_file(large_dict_file, journal_dict_file);
+    for (size_t group : {1, 64, 1024})
+    {
+        std::remove(journal_file);
+        SpellChecker obj(ContainerType::Trie);
+        obj.load(journal_dict_file);
+        obj.open_journal(journal_file, journal_dict_file, group, 0);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (auto &word : extra)
+            obj.add(word);
+        obj.sync_journal();
+        double time = (std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << "journaled add of " << extra.size() << " words, group " << group << ": "
+                  << (int)(time / 1000000) << " ms" << std::endl;
+    }
+
+    copy_file(large_dict_file, journal_merged_file);
+    {
+        std::ofstream out(journal_merged_file, std::ios::app);
+        for (auto &word : extra)
+            out << word << '\n';
+    }
+    // startup cost of both ways to the same dictionary: each checker is
+    // built with nothing else alive, best of three runs
+    typedef std::chrono::high_resolution_clock clock;
+    double merged_time = 1e18, base_time = 1e18, replay_time = 1e18;
+    for (int k = 0; k < 3; ++k)
+    {
+        size_t merged_size;
+        {
+            auto start = clock::now();
+            SpellChecker merged(ContainerType::Trie);
+            merged.load(journal_merged_file);
+            merged_time = std::min<double>(merged_time, (clock::now() - start).count());
+            merged_size = merged.size();
+        }
+        {
+            auto start = clock::now();
+            SpellChecker base(ContainerType::Trie);
+            base.load(journal_dict_file);
+            double loaded = (clock::now() - start).count();
+            base.open_journal(journal_file, journal_dict_file, 64, 0);
+            double opened = (clock::now() - start).count();
+            if (opened < base_time + replay_time)
+            {
+                base_time = loaded;
+                replay_time = opened - loaded;
+            }
+            EXPECT_EQ(base.size(), merged_size);
+        }
+    }
+
+    std::cout << "startup: load merged text " << (int)(merged_time / 1000000) << " ms, load base "
+              << (int)(base_time / 1000000) << " ms + replay journal " << (int)(replay_time / 1000000)
+              << " ms = " << (int)((base_time + replay_time) / 1000000) << " ms" << std::endl;
+    EXPECT_LT(base_time + replay_time, 2 * merged_time);
+    std::remove(journal_file);
+    std::remove(journal_dict_file);
+    std::remove(journal_merged_file);
+}
+
+TEST(BasicSpellChecker, matches_runtime_checker)
+{
+    BasicSpellChecker<SpellChecker_Trie> obj;
+    obj.load(large_dict_file);
+    EXPECT_EQ(obj.size(), large_dict_words_count);
+    for (auto i : list_valid)
+    {
+        EXPECT_EQ(obj.check(i), true);
+    }
+    for (auto i : list_misspelled)
+    {
+        EXPECT_EQ(obj.check(i), false);
+    }
+    auto report = obj.check_document(read_tokens(data[0].text));
+    EXPECT_EQ(report.valid, data[0].valid);
+    EXPECT_EQ(report.misspelled, data[0].missed);
+}
+
+// engines own raw node pointers: copying is rejected, moves hand them over
+template <class Engine>
+void test_move_only()
+{
+    static_assert(!std::is_copy_constructible<BasicSpellChecker<Engine>>::value, "copy shares nodes");
+    static_assert(!std::is_constructible<BasicSpellChecker<Engine>, BasicSpellChecker<Engine> &>::value,
+                  "forwarding constructor copies");
+    std::vector<BasicSpellChecker<Engine>> checkers;
+    for (int i = 0; i < 5; ++i)
+    {
+        checkers.emplace_back();
+        checkers.back().add(list2add[i % 2]);
+    }
+    BasicSpellChecker<Engine> moved(std::move(checkers[0]));
+    EXPECT_EQ(moved.check(list2add[0]), true);
+    for (size_t i = 1; i < checkers.size(); ++i)
+    {
+        EXPECT_EQ(checkers[i].size(), 1);
+        EXPECT_EQ(checkers[i].check(list2add[i % 2]), true);
+        EXPECT_EQ(checkers[i].check(list2add[(i + 1) % 2]), false);
+    }
+}
+
+TEST(BasicSpellChecker, move_only_Trie)
+{
+    test_move_only<SpellChecker_Trie>();
+}
+
+TEST(BasicSpellChecker, move_only_AdaptiveRadixTree)
+{
+    test_move_only<SpellChecker_ART>();
+}
+
+template <class Checker>
+double time_checks(const Checker &obj, const std::vector<std::string> &words, unsigned expected)
+{
+    double time = 0;
+    for (int k = 0; k < speed_test_iterations; k++)
+    {
+        unsigned misspelled = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (auto &word : words)
+            misspelled += !obj.check(word);
+        time += (std::chrono::high_resolution_clock::now() - start).count();
+        EXPECT_EQ(misspelled, expected);
+    }
+    return time;
+}
+
+template <class Engine>
+void report_dispatch_speed(ContainerType type, const char *name)
+{
+    SpellChecker dynamic(type);
+    BasicSpellChecker<Engine> fixed;
+    dynamic.load(large_dict_file);
+    fixed.load(large_dict_file);
+
+    auto words = read_valid_tokens(speedTestData[1].text);
+    auto virtual_time = time_checks(dynamic, words, speedTestData[1].missed);
+    auto static_time = time_checks(fixed, words, speedTestData[1].missed);
+    std::cout << name << ": virtual " << (int)(virtual_time / 1000000) << " ms, static "
+              << (int)(static_time / 1000000) << " ms" << std::endl;
+}
+
+TEST(BasicSpellChecker, front_coded_matches_set)
+{
+    SpellChecker set(ContainerType::Set);
+    set.load(large_dict_file);
+    for (size_t block_size : {1, 16, 32, 64})
+    {
+        BasicSpellChecker<SpellChecker_FrontCoded> obj(block_size);
+        obj.load(large_dict_file);
+        EXPECT_EQ(obj.size(), large_dict_words_count);
+        // every dictionary word, its prefixes and extensions agree with std::set
+        std::ifstream infile(large_dict_file);
+        std::string word;
+        for (int i = 0; infile >> word; ++i)
+        {
+            ASSERT_EQ(obj.check(word), true) << word;
+            if (i % 7 == 0)
+            {
+                for (auto probe : {word.substr(0, word.size() - 1), word + "a", word + "'", word + "z"})
+                {
+                    ASSERT_EQ(obj.check(probe), set.check(probe)) << probe;
+                }
+            }
+        }
+        for (auto probe : {"", "a", "zzzzzz", "'", "aaaa"})
+        {
+            EXPECT_EQ(obj.check(probe), set.check(probe)) << probe;
+        }
+    }
+}
+
+// std::set nodes carry ~70 bytes of overhead per word on top of the string
+TEST(BasicSpellChecker, front_coded_footprint)
+{
+    std::ifstream infile(large_dict_file, std::ios::ate);
+    size_t file_size = infile.tellg();
+    auto words = read_valid_tokens(speedTestData[1].text);
+
+    BasicSpellChecker<SpellChecker_Set> set;
+    set.load(large_dict_file);
+    auto set_time = time_checks(set, words, speedTestData[1].missed);
+    std::cout << "dictionary file " << file_size / 1024 << " KB, Set: "
+              << (int)(set_time / 1000000) << " ms" << std::endl;
+    for (size_t block_size : {16, 32, 64})
+    {
+        BasicSpellChecker<SpellChecker_FrontCoded> obj(block_size);
+        obj.load(large_dict_file);
+        auto stats = obj.stats();
+        EXPECT_EQ(stats.nodes, 0); // not node based
+        EXPECT_LT(stats.bytes, file_size);
+        auto time = time_checks(obj, words, speedTestData[1].missed);
+        std::cout << "FrontCoded block " << block_size << ": " << stats.bytes / 1024 << " KB, "
+                  << (int)(time / 1000000) << " ms" << std::endl;
+    }
+}
+
+TEST(BasicSpellChecker, virtual_vs_static_speed)
+{
+    report_dispatch_speed<SpellChecker_CustomHashTable>(ContainerType::CustomHashTable, "CustomHashTable");
+    report_dispatch_speed<SpellChecker_Trie>(ContainerType::Trie, "Trie");
+    report_dispatch_speed<SpellChecker_ART>(ContainerType::AdaptiveRadixTree, "AdaptiveRadixTree");
+}
+
+void print_counters(const PerfCounters &counters, const std::string &phase, double per)
+{
+    std::cout << std::left << std::setw(36) << phase << std::right << std::fixed << std::setprecision(2);
+    for (int i = 0; i < PerfCounters::EventCount; ++i)
+    {
+        auto event = PerfCounters::Event(i);
+        std::cout << " " << PerfCounters::name(event) << " ";
+        if (counters.available(event))
+            std::cout << counters.value(event) / per;
+        else
+            std::cout << "n/a";
+    }
+    std::cout << std::defaultfloat << std::endl;
+}
+
+// load normalized per dictionary word, check per lookup; Vector is left
+// out as its linear scan would take minutes over the corpora
+TEST(SpellChecker, perf_counters_per_engine)
+{
+    PerfCounters counters;
+    if (!counters.any_hardware())
+        std::cout << "hardware counters unavailable (no PMU or perf_event_paranoid), "
+                  << "reporting software counters only" << std::endl;
+
+    struct
+    {
+        ContainerType type;
+        const char *name;
+    } engines[] = {
+        {ContainerType::Set, "Set"},
+        {ContainerType::Unordered_Set, "Unordered_Set"},
+        {ContainerType::CustomHashTable, "CustomHashTable"},
+        {ContainerType::Trie, "Trie"},
+        {ContainerType::AdaptiveRadixTree, "AdaptiveRadixTree"},
+        {ContainerType::FrontCoded, "FrontCoded"},
+    };
+    TextData texts[] = {data[0], data[1], data[2], speedTestData[1]};
+
+    for (auto engine : engines)
+    {
+        SpellChecker obj(engine.type);
+        counters.start();
+        obj.load(large_dict_file);
+        counters.stop();
+        print_counters(counters, std::string(engine.name) + " load", obj.size());
+
+        for (auto text : texts)
+        {
+            auto words = read_valid_tokens(text.text);
+            if (words.empty())
+                continue;
+            unsigned misspelled = 0;
+            counters.start();
+            for (auto &word : words)
+                misspelled += !obj.check(word);
+            counters.stop();
+            EXPECT_EQ(misspelled, text.missed);
+            std::string name(text.text);
+            print_counters(counters, std::string(engine.name) + " check " + name.substr(name.rfind('/') + 1),
+                           words.size());
+        }
+    }
+}
+
 TEST(SpellChecker, check_speed_acceptable)
 {
     auto time = measure_performance(ContainerType::Fastest);